@@ -0,0 +1,137 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \addtogroup buf buffer manager
+	buffer manager is used, to share same data between many consumers without
+	copy.
+
+	Buffer pool is created with few size classes. buf_alloc() is returning buffer
+	of smallest class, where data fits. If there is no free buffer of that class,
+	next class is used. Data, larger than biggest class is returned as chain
+	of biggest buffers, linked by next.
+
+	Every buffer is reference counted. Producer is allocating buffer with
+	reference count 1, and calling buf_ref() for every extra consumer. Each
+	consumer is calling buf_free() after processing, buffer is returned to
+	pool by last one. For example, sector, readed from storage can be sent to
+	USB host and CRC checker:
+
+	BUF* buf = buf_alloc(pool, SECTOR_SIZE);
+	<read sector to buf->data>
+	buf_ref(buf);
+	<send buf to usb>
+	<send buf to crc>
+
+	Both buf_alloc() and buf_free() are never put thread in waiting state, and
+	can be called from any context, including IRQ. If there is no free buffers,
+	buf_alloc() is returning NULL.
+
+	Plese mind, that space for buffers is allocated in current thread's memory pool.
+	\{
+ */
+
+#include "buf.h"
+#include "sys_call.h"
+#include "sys_calls.h"
+
+/**
+	\brief creates buffer pool.
+	\details Mind, that data blocks will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after buffer pool destruction
+	\param sizes: array of class sizes in bytes, ascending
+	\param counts: array of buffers count for each class
+	\param classes: count of classes
+	\retval pool HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE buf_pool_create(const unsigned int* sizes, const unsigned int* counts, unsigned int classes)
+{
+	return buf_pool_create_aligned(sizes, counts, classes, WORD_SIZE);
+}
+
+/**
+	\brief creates buffer pool with data align.
+	\details Data of every buffer is aligned, for example, to USB_DATA_ALIGN for DMA.
+	Mind, that data blocks will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after buffer pool destruction
+	\param sizes: array of class sizes in bytes, ascending
+	\param counts: array of buffers count for each class
+	\param classes: count of classes
+	\param align: data align. Must be multiples of	WORD_SIZE() and greater 0.
+	\retval pool HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE buf_pool_create_aligned(const unsigned int* sizes, const unsigned int* counts, unsigned int classes, unsigned int align)
+{
+	BUF_POOL_CALL bpc;
+	bpc.sizes = sizes;
+	bpc.counts = counts;
+	bpc.classes = classes;
+	bpc.align = align;
+	return sys_call(BUF_POOL_CREATE, (unsigned int)&bpc, 0, 0);
+}
+
+/**
+	\brief allocate buffer or chain of buffers
+	\param pool: buffer pool
+	\param size: data size in bytes
+	\retval buffer with reference count 1 on success, NULL if there is no free buffers
+*/
+BUF* buf_alloc(HANDLE pool, unsigned int size)
+{
+	return (BUF*)sys_call(BUF_ALLOC, (unsigned int)pool, size, 0);
+}
+
+/**
+	\brief add reference to buffer
+	\param buf: buffer. For chain all buffers are referenced
+	\retval none
+*/
+void buf_ref(BUF* buf)
+{
+	sys_call(BUF_REF, (unsigned int)buf, 0, 0);
+}
+
+/**
+	\brief release reference to buffer. Last reference returns buffer to pool
+	\param buf: buffer. For chain all buffers are released
+	\retval none
+*/
+void buf_free(BUF* buf)
+{
+	sys_call(BUF_FREE, (unsigned int)buf, 0, 0);
+}
+
+/**
+	\brief destroys buffer pool
+	\details MUST be called from same thread, as created
+	\param pool: buffer pool
+	\retval none
+*/
+void buf_pool_destroy(HANDLE pool)
+{
+	sys_call(BUF_POOL_DESTROY, (unsigned int)pool, 0, 0);
+}
+
+/** \} */ // end of buf group
@@ -0,0 +1,54 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BUF_H
+#define BUF_H
+
+#include "types.h"
+
+typedef struct _BUF {
+	//next buffer in chain, NULL for last
+	struct _BUF* next;
+	void* data;
+	//data size in current buffer
+	unsigned int size;
+} BUF;
+
+typedef struct {
+	const unsigned int* sizes;
+	const unsigned int* counts;
+	unsigned int classes;
+	unsigned int align;
+} BUF_POOL_CALL;
+
+HANDLE buf_pool_create(const unsigned int* sizes, const unsigned int* counts, unsigned int classes);
+HANDLE buf_pool_create_aligned(const unsigned int* sizes, const unsigned int* counts, unsigned int classes, unsigned int align);
+BUF* buf_alloc(HANDLE pool, unsigned int size);
+void buf_ref(BUF* buf);
+void buf_free(BUF* buf);
+void buf_pool_destroy(HANDLE pool);
+
+#endif // BUF_H
@@ -0,0 +1,193 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "buf_private.h"
+#include "sys_calls.h"
+#include "mem.h"
+#include "mem_private.h"
+#include "thread_private.h"
+#include "error.h"
+#include "irq.h"
+#include <stddef.h>
+
+const char *const BUF_NAME =								"BUF";
+
+#define BUF_ALIGN(size, align)							(((size) + (align) - 1) / (align) * (align))
+//header is placed right before data, data is aligned
+#define BUF_ENTRY_SIZE(size, align)					(BUF_ALIGN(sizeof(BUF_ENTRY), align) + BUF_ALIGN(size, align))
+#define BUF_TO_ENTRY(buf)									((BUF_ENTRY*)((unsigned int)(buf) - offsetof(BUF_ENTRY, buf)))
+
+static inline void svc_buf_pool_destroy(BUF_POOL* pool)
+{
+	unsigned int i;
+	//MUST be called from same thread, same mem pool
+	for (i = 0; i < pool->classes_count; ++i)
+		if (pool->classes[i].mem_block)
+			free(pool->classes[i].mem_block);
+	sys_free(pool);
+}
+
+static inline BUF_POOL* svc_buf_pool_create(BUF_POOL_CALL* bpc)
+{
+	unsigned int i, j;
+	BUF_CLASS* cls;
+	BUF_ENTRY* entry;
+	BUF_POOL* pool;
+	const unsigned int* sizes = bpc->sizes;
+	const unsigned int* counts = bpc->counts;
+	unsigned int classes = bpc->classes;
+	unsigned int align = bpc->align;
+	//entry headers must stay word aligned
+	if (align == 0 || align % WORD_SIZE)
+	{
+		error_value(ERROR_GENERAL_INVALID_PARAMS, align);
+		return NULL;
+	}
+	pool = sys_alloc(sizeof(BUF_POOL) + classes * sizeof(BUF_CLASS));
+	if (pool == NULL)
+	{
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, BUF_NAME);
+		return NULL;
+	}
+	pool->classes_count = classes;
+	DO_MAGIC(pool, MAGIC_BUF_POOL);
+	for (i = 0; i < classes; ++i)
+		pool->classes[i].mem_block = NULL;
+	for (i = 0; i < classes; ++i)
+	{
+		ASSERT(i == 0 || sizes[i] > sizes[i - 1]);
+		cls = &pool->classes[i];
+		cls->size = sizes[i];
+		cls->count = cls->free_count = counts[i];
+		cls->free_bufs = NULL;
+		//data blocks are in thread's current mempool
+		cls->mem_block = malloc_aligned(counts[i] * BUF_ENTRY_SIZE(sizes[i], align), align);
+		if (cls->mem_block == NULL)
+		{
+			svc_buf_pool_destroy(pool);
+			error(ERROR_MEM_OUT_OF_HEAP, svc_thread_name(svc_thread_get_current()));
+			return NULL;
+		}
+		for (j = 0; j < counts[i]; ++j)
+		{
+			entry = (BUF_ENTRY*)((unsigned int)cls->mem_block + j * BUF_ENTRY_SIZE(sizes[i], align) + BUF_ALIGN(sizeof(BUF_ENTRY), align) - sizeof(BUF_ENTRY));
+			entry->cls = cls;
+			entry->buf.data = (void*)((unsigned int)entry + sizeof(BUF_ENTRY));
+			dlist_add_tail(&cls->free_bufs, (DLIST*)entry);
+		}
+	}
+	return pool;
+}
+
+static BUF* svc_buf_take(BUF_CLASS* cls, unsigned int size)
+{
+	BUF_ENTRY* entry = (BUF_ENTRY*)cls->free_bufs;
+	dlist_remove_head(&cls->free_bufs);
+	--cls->free_count;
+	entry->refcount = 1;
+	entry->buf.next = NULL;
+	entry->buf.size = size;
+	return &entry->buf;
+}
+
+static inline BUF* svc_buf_alloc(BUF_POOL* pool, unsigned int size)
+{
+	CHECK_MAGIC(pool, MAGIC_BUF_POOL, BUF_NAME);
+	unsigned int i, count;
+	BUF_CLASS* cls;
+	BUF* head;
+	BUF* cur;
+	//smallest free class, where size fits
+	for (i = 0; i < pool->classes_count; ++i)
+		if (pool->classes[i].size >= size && pool->classes[i].free_count)
+			return svc_buf_take(&pool->classes[i], size);
+	//chain of largest buffers, all or nothing
+	if (pool->classes_count == 0)
+		return NULL;
+	cls = &pool->classes[pool->classes_count - 1];
+	count = (size + cls->size - 1) / cls->size;
+	if (count == 0 || count > cls->free_count)
+		return NULL;
+	head = cur = svc_buf_take(cls, cls->size);
+	for (i = 1; i < count; ++i)
+	{
+		cur->next = svc_buf_take(cls, cls->size);
+		cur = cur->next;
+	}
+	cur->size = size - (count - 1) * cls->size;
+	return head;
+}
+
+static inline void svc_buf_ref(BUF* buf)
+{
+	for (; buf != NULL; buf = buf->next)
+		++BUF_TO_ENTRY(buf)->refcount;
+}
+
+static inline void svc_buf_free(BUF* buf)
+{
+	BUF_ENTRY* entry;
+	while (buf != NULL)
+	{
+		entry = BUF_TO_ENTRY(buf);
+		buf = buf->next;
+		ASSERT(entry->refcount);
+		if (--entry->refcount == 0)
+		{
+			dlist_add_tail(&entry->cls->free_bufs, (DLIST*)entry);
+			++entry->cls->free_count;
+		}
+	}
+}
+
+unsigned int svc_buf_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CRITICAL_ENTER;
+	unsigned int res = 0;
+	switch (num)
+	{
+	case BUF_POOL_CREATE:
+		res = (unsigned int)svc_buf_pool_create((BUF_POOL_CALL*)param1);
+		break;
+	case BUF_ALLOC:
+		res = (unsigned int)svc_buf_alloc((BUF_POOL*)param1, param2);
+		break;
+	case BUF_REF:
+		svc_buf_ref((BUF*)param1);
+		break;
+	case BUF_FREE:
+		svc_buf_free((BUF*)param1);
+		break;
+	case BUF_POOL_DESTROY:
+		svc_buf_pool_destroy((BUF_POOL*)param1);
+		break;
+	default:
+		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
+	}
+	CRITICAL_LEAVE;
+	return res;
+}
@@ -0,0 +1,59 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BUF_PRIVATE_H
+#define BUF_PRIVATE_H
+
+#include "dlist.h"
+#include "dbg.h"
+#include "buf.h"
+
+typedef struct {
+	unsigned int size;
+	unsigned int count;
+	unsigned int free_count;
+	DLIST* free_bufs;
+	void* mem_block;
+}BUF_CLASS;
+
+//private header of every buffer
+typedef struct {
+	DLIST list;
+	BUF_CLASS* cls;
+	unsigned int refcount;
+	BUF buf;
+}BUF_ENTRY;
+
+typedef struct {
+	MAGIC;
+	unsigned int classes_count;
+	//sorted by size
+	BUF_CLASS classes[];
+}BUF_POOL;
+
+unsigned int svc_buf_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3);
+
+#endif // BUF_PRIVATE_H
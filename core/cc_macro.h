@@ -32,12 +32,14 @@
 	#define __INLINE         __inline                                   /*!< inline keyword for ARM Compiler       */
 	#define __STATIC_INLINE  static __inline
 	#define __PACKED         __packed
+	#define __MEMORY_BARRIER() __dmb(0xf)
 
 #elif defined ( __ICCARM__ )
 	#define __ASM            __asm                                      /*!< asm keyword for IAR Compiler          */
 	#define __INLINE         inline                                     /*!< inline keyword for IAR Compiler. Only available in High optimization mode! */
 	#define __STATIC_INLINE  static inline 
 	#define __PACKED         __attribute__((packed))
+	#define __MEMORY_BARRIER() __ASM volatile ("dmb" ::: "memory")
 
 #elif defined ( __GNUC__ )
 	#define __ASM            __asm                                      /*!< asm keyword for GNU Compiler          */
@@ -47,6 +49,14 @@
 	//read R/C register
 	#define __REG_RC16(reg)	 volatile uint16_t __attribute__ ((unused)) __reg = (reg)
 	#define __REG_RC32(reg)	 volatile uint32_t __attribute__ ((unused)) __reg = (reg)
+	//ordering for lock-free structures. ARM7 is single core without dmb, compiler barrier is enough
+	#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+	#define __MEMORY_BARRIER() __ASM volatile ("dmb" ::: "memory")
+	#elif defined(__arm__)
+	#define __MEMORY_BARRIER() __ASM volatile ("" ::: "memory")
+	#else
+	#define __MEMORY_BARRIER() __sync_synchronize()
+	#endif
 
 #elif defined ( __TASKING__ )
   #define __ASM            __asm                                      /*!< asm keyword for TASKING Compiler      */
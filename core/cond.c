@@ -0,0 +1,146 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \addtogroup cond condition variable
+	condition variable is a sync object. It's used with mutex to wait for
+	complex predicate, protected by mutex.
+
+	sequence for waiting:
+
+	mutex_lock*(mutex, <time>);
+	while (!<predicate>)
+		cond_wait*(cond, mutex, <time>);
+	<process>
+	mutex_unlock(mutex);
+
+	sequence for signalling:
+
+	mutex_lock*(mutex, <time>);
+	<change predicate>
+	cond_signal(cond);
+	mutex_unlock(mutex);
+
+	cond_wait() is releasing mutex and putting current thread in waiting
+	state by single call, so no signal can be lost. Before return, mutex
+	is reacquired, even on timeout.
+
+	cond_signal() is waking highest priority waiter, cond_broadcast() is
+	waking all waiters. Waked thread is not scheduled, until it's not
+	owning mutex.
+
+	Because cond_wait can put current thread in waiting state, it can be
+	called only from SYSTEM/USER contex
+	\{
+ */
+
+#include "cond.h"
+#include "sys_call.h"
+#include "sys_calls.h"
+
+/**
+	\brief creates condition variable object.
+	\retval condition variable HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE cond_create()
+{
+	return sys_call(COND_CREATE, 0, 0, 0);
+}
+
+/**
+	\brief release mutex and wait for condition
+	\details If mutex is not owned by current thread, exception is raised and current thread terminated
+	\param cond: condition variable handle
+	\param mutex: mutex handle, locked by current thread. Will be locked again on return
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool cond_wait(HANDLE cond, HANDLE mutex, TIME* timeout)
+{
+	return sys_call(COND_WAIT, (unsigned int)cond, (unsigned int)mutex, (unsigned int)timeout);
+}
+
+/**
+	\brief release mutex and wait for condition
+	\details If mutex is not owned by current thread, exception is raised and current thread terminated
+	\param cond: condition variable handle
+	\param mutex: mutex handle, locked by current thread. Will be locked again on return
+	\param timeout_ms: time to wait in milliseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool cond_wait_ms(HANDLE cond, HANDLE mutex, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(COND_WAIT, (unsigned int)cond, (unsigned int)mutex, (unsigned int)&timeout);
+}
+
+/**
+	\brief release mutex and wait for condition
+	\details If mutex is not owned by current thread, exception is raised and current thread terminated
+	\param cond: condition variable handle
+	\param mutex: mutex handle, locked by current thread. Will be locked again on return
+	\param timeout_us: time to wait in microseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool cond_wait_us(HANDLE cond, HANDLE mutex, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(COND_WAIT, (unsigned int)cond, (unsigned int)mutex, (unsigned int)&timeout);
+}
+
+/**
+	\brief wake up highest priority waiter
+	\param cond: condition variable handle
+	\retval none
+*/
+void cond_signal(HANDLE cond)
+{
+	sys_call(COND_SIGNAL, (unsigned int)cond, 0, 0);
+}
+
+/**
+	\brief wake up all waiters
+	\param cond: condition variable handle
+	\retval none
+*/
+void cond_broadcast(HANDLE cond)
+{
+	sys_call(COND_BROADCAST, (unsigned int)cond, 0, 0);
+}
+
+/**
+	\brief destroy condition variable
+	\details all waiters are returning false, after mutex reacquire
+	\param cond: condition variable handle
+	\retval none
+*/
+void cond_destroy(HANDLE cond)
+{
+	sys_call(COND_DESTROY, (unsigned int)cond, 0, 0);
+}
+
+/** \} */ // end of cond group
@@ -0,0 +1,168 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cond_private.h"
+#include "sys_calls.h"
+#include "mem.h"
+#include "mem_private.h"
+#include "error.h"
+#include "thread_private.h"
+#include "irq.h"
+
+const char *const COND_NAME =							"COND";
+
+static inline COND* svc_cond_create()
+{
+	COND* cond = sys_alloc(sizeof(COND));
+	if (cond != NULL)
+	{
+		cond->waiters = NULL;
+		DO_MAGIC(cond, MAGIC_COND);
+	}
+	else
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, COND_NAME);
+
+	return cond;
+}
+
+//thread is still in waiting state. It will be waked up only as mutex owner
+static void svc_cond_reacquire(THREAD* thread, MUTEX* mutex)
+{
+	if (mutex->owner == NULL)
+	{
+		mutex->owner = thread;
+		dlist_add_tail((DLIST**)&thread->owned_mutexes, (DLIST*)mutex);
+		//for ceiling mutex
+		svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
+		svc_thread_wakeup(thread);
+	}
+	//continue waiting on mutex without timeout, like any other mutex waiter
+	else
+	{
+		svc_thread_change_sync_object(thread, THREAD_SYNC_MUTEX, mutex);
+		dlist_add_tail((DLIST**)&mutex->waiters, (DLIST*)thread);
+		svc_thread_set_current_priority(mutex->owner, svc_mutex_calculate_owner_priority(mutex->owner));
+	}
+}
+
+static inline bool svc_cond_wait(COND* cond, MUTEX* mutex, TIME* time)
+{
+	CHECK_MAGIC(cond, MAGIC_COND, COND_NAME);
+	CHECK_MAGIC(mutex, MAGIC_MUTEX, MUTEX_NAME);
+	THREAD* thread = svc_thread_get_current();
+	DLIST_ENUM de;
+	THREAD* cur;
+	if (mutex->owner != thread)
+	{
+		error(ERROR_SYNC_WRONG_UNLOCKER, svc_thread_name(thread));
+		return false;
+	}
+	//release mutex and wait in same call, so signal between them can't be lost.
+	//Sleep first: releasing can wake next owner or drop our inherited priority, switching current thread
+	svc_thread_sleep(time, THREAD_SYNC_COND, cond);
+	thread->sync_param = mutex;
+	svc_mutex_lock_release(mutex, thread);
+	//highest priority waiter is first, same priority - FIFO
+	dlist_enum_start((DLIST**)&cond->waiters, &de);
+	while (dlist_enum(&de, (DLIST**)&cur))
+		if (cur->current_priority > thread->current_priority)
+		{
+			dlist_add_before((DLIST**)&cond->waiters, (DLIST*)cur, (DLIST*)thread);
+			return true;
+		}
+	dlist_add_tail((DLIST**)&cond->waiters, (DLIST*)thread);
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+void svc_cond_lock_release(COND* cond, THREAD* thread)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CHECK_MAGIC(cond, MAGIC_COND, COND_NAME);
+	dlist_remove((DLIST**)&cond->waiters, (DLIST*)thread);
+}
+
+void svc_cond_timeout(COND* cond, THREAD* thread)
+{
+	svc_cond_lock_release(cond, thread);
+	//patch return value
+	thread_patch_context(thread, false);
+	svc_cond_reacquire(thread, (MUTEX*)thread->sync_param);
+}
+
+static inline void svc_cond_signal(COND* cond)
+{
+	CHECK_MAGIC(cond, MAGIC_COND, COND_NAME);
+	THREAD* thread = cond->waiters;
+	if (thread)
+	{
+		dlist_remove_head((DLIST**)&cond->waiters);
+		svc_cond_reacquire(thread, (MUTEX*)thread->sync_param);
+	}
+}
+
+static inline void svc_cond_broadcast(COND* cond)
+{
+	CHECK_MAGIC(cond, MAGIC_COND, COND_NAME);
+	while (cond->waiters)
+		svc_cond_signal(cond);
+}
+
+static inline void svc_cond_destroy(COND* cond)
+{
+	while (cond->waiters)
+		svc_cond_timeout(cond, cond->waiters);
+	sys_free(cond);
+}
+
+unsigned int svc_cond_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT);
+	CRITICAL_ENTER;
+	unsigned int res = 0;
+	switch (num)
+	{
+	case COND_CREATE:
+		res = (unsigned int)svc_cond_create();
+		break;
+	case COND_WAIT:
+		res = (unsigned int)svc_cond_wait((COND*)param1, (MUTEX*)param2, (TIME*)param3);
+		break;
+	case COND_SIGNAL:
+		svc_cond_signal((COND*)param1);
+		break;
+	case COND_BROADCAST:
+		svc_cond_broadcast((COND*)param1);
+		break;
+	case COND_DESTROY:
+		svc_cond_destroy((COND*)param1);
+		break;
+	default:
+		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
+	}
+	CRITICAL_LEAVE;
+	return res;
+}
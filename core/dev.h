@@ -36,11 +36,16 @@
 	- core functionality
 		- \ref thread
 		- \ref mutex
+		- \ref rwlock
+		- \ref cond
 		- \ref event
 		- \ref semaphore
 		- \ref data_queue
 		- \ref message_queue
+		- \ref ipc
+		- \ref pubsub
 	- \ref memory
+	- \ref buf
 	- library functions
 		- \ref lib_time
 		- \ref lib_printf
@@ -48,6 +53,9 @@
 		- \ref lib_dlist
 		- \ref lib_rb
 		- \ref lib_rb_block
+		- \ref lib_rb_spsc
+		- \ref lib_mailbox
+		- \ref lib_triple_buf
 	- debug and error handling
 		- \ref error
 		- \ref debug
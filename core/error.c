@@ -49,7 +49,8 @@ const char* const GENERAL_ERRORS[] =				{"Abstract general error",
 																 "Unaligned access",
 																 "No coprocessor found",
 																 "Invalid state",
-																 "SYS call, while interrupts are disabled"};
+																 "SYS call, while interrupts are disabled",
+																 "Invalid parameters"};
 const char* const MEM_ERRORS[] =						{"Abstract memory error",
 																 "Pointer outside of memory pool",
 																 "Range check failed",
@@ -72,7 +73,8 @@ const char* const THREAD_ERRORS[] =					{"Abstract thread error",
 const char* const SYNC_ERRORS[] =					{"Abstract sync objec error",
 																 "Wrong unlocker for sync object",
 																 "Sync object already owned by caller",
-																 "Sync object already unlocked"};
+																 "Sync object already unlocked",
+																 "Sync object priority ceiling violation"};
 
 const char *const *const ERRORS[] =					{GENERAL_ERRORS, MEM_ERRORS, DEV_ERRORS, THREAD_ERRORS, SYNC_ERRORS};
 
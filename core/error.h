@@ -63,6 +63,7 @@ typedef enum {
 	ERROR_GENERAL_NO_COPROCESSOR,
 	ERROR_GENERAL_INVALID_STATE,
 	ERROR_GENERAL_SYS_CALL_ON_DISABLED_INTERRUPTS,
+	ERROR_GENERAL_INVALID_PARAMS,
 
 	ERROR_MEMORY = ERROR_GROUP_MEMORY * ERROR_GROUP_SIZE,
 	ERROR_MEM_POOL_INVALID_PTR,
@@ -86,7 +87,8 @@ typedef enum {
 	ERROR_SYNC = ERROR_GROUP_SYNC * ERROR_GROUP_SIZE,
 	ERROR_SYNC_WRONG_UNLOCKER,
 	ERROR_SYNC_ALREADY_OWNED,
-	ERROR_SYNC_ALREADY_UNLOCKED
+	ERROR_SYNC_ALREADY_UNLOCKED,
+	ERROR_SYNC_CEILING_VIOLATION
 } ERROR_CODE;
 
 //unrecovered fatal error. System will reboot
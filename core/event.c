@@ -32,6 +32,11 @@
 	active, every event waiting functions returns immediatly. If event
 	is inactive, event waiting put thread in waiting state.
 
+	auto-reset event, created by event_create_auto_reset() is releasing only
+	one waiter - with highest priority, and going inactive. If there are no
+	waiters, event_set() makes event active until first event_wait. It's useful
+	for work dispatching, when only one of many workers must be waked up.
+
 	Because event_wait, event_wait_ms, event_wait_us can put current
 	thread in waiting state, this functions can be called only from
 	SYSTEM/USER context. Other functions, including event_set, event_pulse
@@ -53,7 +58,17 @@ HANDLE event_create()
 }
 
 /**
-	\brief make event active, release all waiters, go inactive state
+	\brief creates auto-reset event object.
+	\retval event HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE event_create_auto_reset()
+{
+	return sys_call(EVENT_CREATE_AUTO_RESET, 0, 0, 0);
+}
+
+/**
+	\brief make event active, release all waiters, go inactive state.
+	For auto-reset event only one waiter is released
 	\param event: event handle
 	\retval none
 */
@@ -63,7 +78,8 @@ void event_pulse(HANDLE event)
 }
 
 /**
-	\brief make event active, release all waiters, stay in active state
+	\brief make event active, release all waiters, stay in active state.
+	For auto-reset event only one waiter is released. If there are no waiters, event stays active
 	\param event: event handle
 	\retval none
 */
@@ -31,6 +31,7 @@
 #include "types.h"
 
 HANDLE event_create();
+HANDLE event_create_auto_reset();
 void event_pulse(HANDLE event);
 void event_set(HANDLE event);
 bool event_is_set(HANDLE event);
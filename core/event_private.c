@@ -34,12 +34,13 @@
 
 const char *const EVENT_NAME =							"EVENT";
 
-static inline EVENT* svc_event_create()
+static inline EVENT* svc_event_create(bool auto_reset)
 {
 	EVENT* event = sys_alloc(sizeof(EVENT));
 	if (event != NULL)
 	{
 		event->set = false;
+		event->auto_reset = auto_reset;
 		event->waiters = NULL;
 		DO_MAGIC(event, MAGIC_EVENT);
 	}
@@ -48,13 +49,36 @@ static inline EVENT* svc_event_create()
 	return event;
 }
 
+//highest priority waiter, same priority - FIFO
+static inline THREAD* svc_event_first_waiter(EVENT* event)
+{
+	DLIST_ENUM de;
+	THREAD* cur;
+	THREAD* thread = event->waiters;
+	dlist_enum_start((DLIST**)&event->waiters, &de);
+	while (dlist_enum(&de, (DLIST**)&cur))
+		if (cur->current_priority < thread->current_priority)
+			thread = cur;
+	return thread;
+}
+
 void svc_event_pulse(EVENT* event)
 {
 	CHECK_MAGIC(event, MAGIC_EVENT, EVENT_NAME);
 
-	//release all waiters
 	THREAD* thread;
-	while (event->waiters)
+	//release only one waiter
+	if (event->auto_reset)
+	{
+		if (event->waiters)
+		{
+			thread = svc_event_first_waiter(event);
+			dlist_remove((DLIST**)&event->waiters, (DLIST*)thread);
+			svc_thread_wakeup(thread);
+		}
+	}
+	//release all waiters
+	else while (event->waiters)
 	{
 		thread = event->waiters;
 		dlist_remove_head((DLIST**)&event->waiters);
@@ -64,8 +88,10 @@ void svc_event_pulse(EVENT* event)
 
 static inline void svc_event_set(EVENT* event)
 {
+	//auto-reset event is consumed by waiter, if any
+	bool consumed = event->auto_reset && event->waiters;
 	svc_event_pulse(event);
-	event->set = true;
+	event->set = !consumed;
 }
 
 static inline bool svc_event_is_set(EVENT* event)
@@ -84,7 +110,10 @@ static inline bool svc_event_wait(EVENT* event, TIME* time)
 	CHECK_MAGIC(event, MAGIC_EVENT, EVENT_NAME);
 
 	THREAD* thread = svc_thread_get_current();
-	if (!event->set)
+	//first waiter takes auto-reset event
+	if (event->set && event->auto_reset)
+		event->set = false;
+	else if (!event->set)
 	{
 		//first - remove from active list
 		//if called from IRQ context, thread_private.c will raise error
@@ -123,7 +152,7 @@ unsigned int svc_event_handler(unsigned int num, unsigned int param1, unsigned i
 	switch (num)
 	{
 	case EVENT_CREATE:
-		res = (unsigned int)svc_event_create();
+		res = (unsigned int)svc_event_create(false);
 		break;
 	case EVENT_PULSE:
 		svc_event_pulse((EVENT*)param1);
@@ -143,6 +172,9 @@ unsigned int svc_event_handler(unsigned int num, unsigned int param1, unsigned i
 	case EVENT_DESTROY:
 		svc_event_destroy((EVENT*)param1);
 		break;
+	case EVENT_CREATE_AUTO_RESET:
+		res = (unsigned int)svc_event_create(true);
+		break;
 	default:
 		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
 	}
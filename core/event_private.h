@@ -33,6 +33,8 @@
 typedef struct {
 	MAGIC;
 	bool set;
+	//release only one waiter and go inactive
+	bool auto_reset;
 	THREAD* waiters;
 }EVENT;
 
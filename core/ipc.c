@@ -0,0 +1,193 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \addtogroup ipc synchronous IPC
+	IPC is a sync object for synchronous request/response between threads.
+	Message is small - command and 3 parameters, it's copied by kernel.
+
+	sequence for client:
+
+	IPC msg;
+	<fill msg>
+	ipc_call*(ipc, &msg, <time>);
+	<process reply in msg>
+
+	sequence for server:
+
+	IPC msg;
+	ipc_receive*(ipc, &msg, <time>);
+	for (;;)
+	{
+		<process request, fill reply in msg>
+		ipc_reply_receive(ipc, &msg, <time>);
+	}
+
+	While request is served, server is running with client priority, if
+	it's higher. If server is waiting in ipc_receive, ipc_call switches
+	directly to server, without passing through scheduler ready list. Same
+	is for ipc_reply_receive back to client. Timeout of ipc_call covers
+	whole request/response time.
+
+	Only one thread can serve IPC object at time.
+
+	Because all IPC functions can put current thread in waiting state, they
+	can be called only from SYSTEM/USER context
+	\{
+ */
+
+#include "ipc.h"
+#include "sys_call.h"
+#include "sys_calls.h"
+
+/**
+	\brief creates IPC object.
+	\retval IPC HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE ipc_create()
+{
+	return sys_call(IPC_CREATE, 0, 0, 0);
+}
+
+/**
+	\brief send request to server and wait for reply
+	\param ipc: IPC handle
+	\param msg: request. Reply will be placed here
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool ipc_call(HANDLE ipc, IPC* msg, TIME* timeout)
+{
+	return sys_call(IPC_CALL, (unsigned int)ipc, (unsigned int)msg, (unsigned int)timeout);
+}
+
+/**
+	\brief send request to server and wait for reply
+	\param ipc: IPC handle
+	\param msg: request. Reply will be placed here
+	\param timeout_ms: timeout in milliseconds
+	\retval true on success, false on timeout
+*/
+bool ipc_call_ms(HANDLE ipc, IPC* msg, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(IPC_CALL, (unsigned int)ipc, (unsigned int)msg, (unsigned int)&timeout);
+}
+
+/**
+	\brief send request to server and wait for reply
+	\param ipc: IPC handle
+	\param msg: request. Reply will be placed here
+	\param timeout_us: timeout in microseconds
+	\retval true on success, false on timeout
+*/
+bool ipc_call_us(HANDLE ipc, IPC* msg, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(IPC_CALL, (unsigned int)ipc, (unsigned int)msg, (unsigned int)&timeout);
+}
+
+/**
+	\brief wait for request
+	\details If previous request is not replied, exception is raised and current thread terminated
+	\param ipc: IPC handle
+	\param msg: received request
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool ipc_receive(HANDLE ipc, IPC* msg, TIME* timeout)
+{
+	return sys_call(IPC_RECEIVE, (unsigned int)ipc, (unsigned int)msg, (unsigned int)timeout);
+}
+
+/**
+	\brief wait for request
+	\details If previous request is not replied, exception is raised and current thread terminated
+	\param ipc: IPC handle
+	\param msg: received request
+	\param timeout_ms: timeout in milliseconds
+	\retval true on success, false on timeout
+*/
+bool ipc_receive_ms(HANDLE ipc, IPC* msg, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(IPC_RECEIVE, (unsigned int)ipc, (unsigned int)msg, (unsigned int)&timeout);
+}
+
+/**
+	\brief wait for request
+	\details If previous request is not replied, exception is raised and current thread terminated
+	\param ipc: IPC handle
+	\param msg: received request
+	\param timeout_us: timeout in microseconds
+	\retval true on success, false on timeout
+*/
+bool ipc_receive_us(HANDLE ipc, IPC* msg, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(IPC_RECEIVE, (unsigned int)ipc, (unsigned int)msg, (unsigned int)&timeout);
+}
+
+/**
+	\brief reply to received request
+	\details If current thread is not serving request, exception is raised and current thread terminated
+	\param ipc: IPC handle
+	\param msg: reply
+	\retval none
+*/
+void ipc_reply(HANDLE ipc, IPC* msg)
+{
+	sys_call(IPC_REPLY, (unsigned int)ipc, (unsigned int)msg, 0);
+}
+
+/**
+	\brief reply to received request and wait for next request by single call
+	\details If current thread is not serving request, exception is raised and current thread terminated
+	\param ipc: IPC handle
+	\param msg: reply. Next request will be placed here
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool ipc_reply_receive(HANDLE ipc, IPC* msg, TIME* timeout)
+{
+	return sys_call(IPC_REPLY_RECEIVE, (unsigned int)ipc, (unsigned int)msg, (unsigned int)timeout);
+}
+
+/**
+	\brief destroys IPC object
+	\details all waiting threads will return false
+	\param ipc: IPC handle
+	\retval none
+*/
+void ipc_destroy(HANDLE ipc)
+{
+	sys_call(IPC_DESTROY, (unsigned int)ipc, 0, 0);
+}
+
+/** \} */ // end of ipc group
@@ -0,0 +1,51 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IPC_H
+#define IPC_H
+
+#include "types.h"
+#include "sys_time.h"
+
+typedef struct {
+	unsigned int cmd;
+	unsigned int param1;
+	unsigned int param2;
+	unsigned int param3;
+} IPC;
+
+HANDLE ipc_create();
+bool ipc_call(HANDLE ipc, IPC* msg, TIME* timeout);
+bool ipc_call_ms(HANDLE ipc, IPC* msg, unsigned int timeout_ms);
+bool ipc_call_us(HANDLE ipc, IPC* msg, unsigned int timeout_us);
+bool ipc_receive(HANDLE ipc, IPC* msg, TIME* timeout);
+bool ipc_receive_ms(HANDLE ipc, IPC* msg, unsigned int timeout_ms);
+bool ipc_receive_us(HANDLE ipc, IPC* msg, unsigned int timeout_us);
+void ipc_reply(HANDLE ipc, IPC* msg);
+bool ipc_reply_receive(HANDLE ipc, IPC* msg, TIME* timeout);
+void ipc_destroy(HANDLE ipc);
+
+#endif // IPC_H
@@ -0,0 +1,253 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ipc_private.h"
+#include "sys_calls.h"
+#include "mem.h"
+#include "mem_private.h"
+#include "mutex_private.h"
+#include "error.h"
+#include "irq.h"
+
+const char *const IPC_NAME =								"IPC";
+
+static inline IPC_ENDPOINT* svc_ipc_create()
+{
+	IPC_ENDPOINT* ep = sys_alloc(sizeof(IPC_ENDPOINT));
+	if (ep != NULL)
+	{
+		ep->receiver = NULL;
+		ep->callers = NULL;
+		ep->client = NULL;
+		ep->server = NULL;
+		DO_MAGIC(ep, MAGIC_IPC);
+	}
+	else
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, IPC_NAME);
+	return ep;
+}
+
+static inline void svc_ipc_accept(IPC_ENDPOINT* ep, THREAD* server, THREAD* client, IPC* msg)
+{
+	*msg = *(IPC*)client->sync_param;
+	ep->client = client;
+	ep->server = server;
+	//server is running with client priority, while serving him
+	if (client->current_priority < server->current_priority)
+		svc_thread_set_current_priority(server, client->current_priority);
+}
+
+//returns client, waiting for reply. Reply is already copied
+static THREAD* svc_ipc_detach(IPC_ENDPOINT* ep, IPC* msg)
+{
+	THREAD* client = ep->client;
+	ep->client = NULL;
+	ep->server = NULL;
+	//client can be already gone by timeout
+	if (client)
+		*(IPC*)client->sync_param = *msg;
+	return client;
+}
+
+static inline bool svc_ipc_call(IPC_ENDPOINT* ep, IPC* msg, TIME* time)
+{
+	CHECK_MAGIC(ep, MAGIC_IPC, IPC_NAME);
+	THREAD* thread = svc_thread_get_current();
+	THREAD* server = ep->receiver;
+	thread->sync_param = msg;
+	if (server)
+	{
+		ep->receiver = NULL;
+		svc_ipc_accept(ep, server, thread, (IPC*)server->sync_param);
+		//direct switch to server, if possible
+		if (!svc_thread_handoff(server, time, THREAD_SYNC_IPC, ep))
+		{
+			svc_thread_sleep(time, THREAD_SYNC_IPC, ep);
+			svc_thread_wakeup(server);
+		}
+	}
+	else
+	{
+		//first - remove from active list
+		//if called from IRQ context, thread_private.c will raise error
+		svc_thread_sleep(time, THREAD_SYNC_IPC, ep);
+		dlist_add_tail((DLIST**)&ep->callers, (DLIST*)thread);
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+static inline bool svc_ipc_receive(IPC_ENDPOINT* ep, IPC* msg, TIME* time)
+{
+	CHECK_MAGIC(ep, MAGIC_IPC, IPC_NAME);
+	THREAD* thread = svc_thread_get_current();
+	THREAD* client = ep->callers;
+	//only one server at time, and server must reply before next receive
+	if (ep->receiver || ep->server)
+	{
+		error(ERROR_SYNC_ALREADY_OWNED, svc_thread_name(thread));
+		return false;
+	}
+	if (client)
+	{
+		dlist_remove_head((DLIST**)&ep->callers);
+		svc_ipc_accept(ep, thread, client, msg);
+	}
+	else
+	{
+		svc_thread_sleep(time, THREAD_SYNC_IPC, ep);
+		thread->sync_param = msg;
+		ep->receiver = thread;
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+static inline void svc_ipc_reply(IPC_ENDPOINT* ep, IPC* msg)
+{
+	CHECK_MAGIC(ep, MAGIC_IPC, IPC_NAME);
+	THREAD* thread = svc_thread_get_current();
+	THREAD* client;
+	if (ep->server != thread)
+	{
+		error(ERROR_SYNC_WRONG_UNLOCKER, svc_thread_name(thread));
+		return;
+	}
+	client = svc_ipc_detach(ep, msg);
+	//drop donated priority
+	svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
+	if (client)
+		svc_thread_wakeup(client);
+}
+
+static inline bool svc_ipc_reply_receive(IPC_ENDPOINT* ep, IPC* msg, TIME* time)
+{
+	CHECK_MAGIC(ep, MAGIC_IPC, IPC_NAME);
+	THREAD* thread = svc_thread_get_current();
+	THREAD* client;
+	THREAD* next;
+	if (ep->server != thread)
+	{
+		error(ERROR_SYNC_WRONG_UNLOCKER, svc_thread_name(thread));
+		return false;
+	}
+	client = svc_ipc_detach(ep, msg);
+	//next call is pending, serve it at once. Accepted before client wakeup, which can switch current thread
+	if (ep->callers)
+	{
+		next = ep->callers;
+		dlist_remove_head((DLIST**)&ep->callers);
+		svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
+		svc_ipc_accept(ep, thread, next, msg);
+		if (client)
+			svc_thread_wakeup(client);
+		return true;
+	}
+	thread->sync_param = msg;
+	//direct switch back to client, if possible
+	if (client == NULL || !svc_thread_handoff(client, time, THREAD_SYNC_IPC, ep))
+	{
+		svc_thread_sleep(time, THREAD_SYNC_IPC, ep);
+		if (client)
+			svc_thread_wakeup(client);
+	}
+	//we are waiting now, so donated priority is dropped without reschedule
+	svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
+	ep->receiver = thread;
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+void svc_ipc_lock_release(IPC_ENDPOINT* ep, THREAD* thread)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CHECK_MAGIC(ep, MAGIC_IPC, IPC_NAME);
+	if (thread == ep->receiver)
+		ep->receiver = NULL;
+	else if (thread == ep->client)
+	{
+		ep->client = NULL;
+		//server is not serving us anymore, drop donated priority
+		svc_thread_set_current_priority(ep->server, svc_mutex_calculate_owner_priority(ep->server));
+	}
+	else
+		dlist_remove((DLIST**)&ep->callers, (DLIST*)thread);
+}
+
+static inline void svc_ipc_cancel(THREAD* thread)
+{
+	//patch return value
+	thread_patch_context(thread, false);
+	svc_thread_wakeup(thread);
+}
+
+static inline void svc_ipc_destroy(IPC_ENDPOINT* ep)
+{
+	THREAD* thread;
+	if (ep->receiver)
+		svc_ipc_cancel(ep->receiver);
+	if (ep->client)
+		svc_ipc_cancel(ep->client);
+	while (ep->callers)
+	{
+		thread = ep->callers;
+		dlist_remove_head((DLIST**)&ep->callers);
+		svc_ipc_cancel(thread);
+	}
+	sys_free(ep);
+}
+
+unsigned int svc_ipc_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT);
+	CRITICAL_ENTER;
+	unsigned int res = 0;
+	switch (num)
+	{
+	case IPC_CREATE:
+		res = (unsigned int)svc_ipc_create();
+		break;
+	case IPC_CALL:
+		res = (unsigned int)svc_ipc_call((IPC_ENDPOINT*)param1, (IPC*)param2, (TIME*)param3);
+		break;
+	case IPC_RECEIVE:
+		res = (unsigned int)svc_ipc_receive((IPC_ENDPOINT*)param1, (IPC*)param2, (TIME*)param3);
+		break;
+	case IPC_REPLY:
+		svc_ipc_reply((IPC_ENDPOINT*)param1, (IPC*)param2);
+		break;
+	case IPC_REPLY_RECEIVE:
+		res = (unsigned int)svc_ipc_reply_receive((IPC_ENDPOINT*)param1, (IPC*)param2, (TIME*)param3);
+		break;
+	case IPC_DESTROY:
+		svc_ipc_destroy((IPC_ENDPOINT*)param1);
+		break;
+	default:
+		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
+	}
+	CRITICAL_LEAVE;
+	return res;
+}
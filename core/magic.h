@@ -43,6 +43,12 @@
 #define MAGIC_EVENT									0x57e198c7
 #define MAGIC_SEMAPHORE								0xabfd92d9
 #define MAGIC_QUEUE									0x6b54bbeb
+#define MAGIC_RWLOCK									0x3c9a51e4
+#define MAGIC_COND									0x91f7a53d
+#define MAGIC_IPC										0x4e2d86b1
+#define MAGIC_BUF_POOL								0x7a13cf58
+#define MAGIC_TOPIC									0x2f6b0e93
+#define MAGIC_SUBSCRIBER							0xc4587a1d
 
 #define MAGIC_UNINITIALIZED						0xcdcdcdcd
 #define MAGIC_UNINITIALIZED_BYTE					0xcd
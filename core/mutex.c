@@ -45,6 +45,14 @@
 
 	After releasing mutex, thread priority is returned to base.
 
+	Mutex, created by mutex_create_ceiling() is using immediate priority ceiling
+	protocol instead: owner priority is raised to ceiling on mutex_lock() and
+	restored on mutex_unlock(). Ceiling must be not lower, than priority of any
+	thread, using mutex. It's cheaper, than inheritance - waiters are never
+	scanned, and there is no chained blocking.
+	Ceiling mutexes can be nested: ceiling is checked against thread base priority,
+	not against priority, already raised by other ceiling mutex.
+
 	Because mutex_lock can put current thread in waiting state, mutex
 	locking/unlocking can be called only from SYSTEM/USER contex
 	\{
@@ -63,6 +71,16 @@ HANDLE mutex_create()
 	return sys_call(MUTEX_CREATE, 0, 0, 0);
 }
 
+/**
+	\brief creates mutex object with priority ceiling.
+	\param ceiling: priority ceiling. Locking thread with higher priority will raise error
+	\retval mutex HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE mutex_create_ceiling(unsigned int ceiling)
+{
+	return sys_call(MUTEX_CREATE_CEILING, ceiling, 0, 0);
+}
+
 /**
 	\brief try to lock mutex.
 	\details If mutex is already locked, exception is raised and current thread terminated
@@ -31,6 +31,7 @@
 #include "sys_time.h"
 
 HANDLE mutex_create();
+HANDLE mutex_create_ceiling(unsigned int ceiling);
 bool mutex_lock(HANDLE mutex, TIME* timeout);
 bool mutex_lock_ms(HANDLE mutex, unsigned int timeout_ms);
 bool mutex_lock_us(HANDLE mutex, unsigned int timeout_us);
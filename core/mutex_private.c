@@ -34,13 +34,15 @@
 
 const char *const MUTEX_NAME =							"MUTEX";
 
-static inline MUTEX* svc_mutex_create()
+static inline MUTEX* svc_mutex_create(unsigned int ceiling)
 {
 	MUTEX* mutex = sys_alloc(sizeof(MUTEX));
 	if (mutex != NULL)
 	{
 		mutex->owner = NULL;
 		mutex->waiters = NULL;
+		mutex->owned.waiters = &mutex->waiters;
+		mutex->owned.ceiling = ceiling;
 		DO_MAGIC(mutex, MAGIC_MUTEX);
 	}
 	else
@@ -53,15 +55,24 @@ unsigned int svc_mutex_calculate_owner_priority(THREAD* thread)
 {
 	unsigned int priority = thread->base_priority;
 	DLIST_ENUM owned_mutexes, thread_waiters;
-	MUTEX* current_mutex;
+	MUTEX_OWNED* current_owned;
 	THREAD* current_thread;
 	dlist_enum_start(&thread->owned_mutexes, &owned_mutexes);
-	while (dlist_enum(&owned_mutexes, (DLIST**)&current_mutex))
+	while (dlist_enum(&owned_mutexes, (DLIST**)&current_owned))
 	{
-		dlist_enum_start((DLIST**)&current_mutex->waiters, &thread_waiters);
-		while (dlist_enum(&thread_waiters, (DLIST**)&current_thread))
-			if (current_thread->current_priority < priority)
-				priority = current_thread->current_priority;
+		//waiters of ceiling mutex can't have priority higher, than ceiling. No need to scan them
+		if (current_owned->ceiling != MUTEX_NO_CEILING)
+		{
+			if (current_owned->ceiling < priority)
+				priority = current_owned->ceiling;
+		}
+		else
+		{
+			dlist_enum_start((DLIST**)current_owned->waiters, &thread_waiters);
+			while (dlist_enum(&thread_waiters, (DLIST**)&current_thread))
+				if (current_thread->current_priority < priority)
+					priority = current_thread->current_priority;
+		}
 	}
 	return priority;
 }
@@ -70,7 +81,10 @@ static inline bool svc_mutex_lock(MUTEX* mutex, TIME* time)
 {
 	CHECK_MAGIC(mutex, MAGIC_MUTEX, MUTEX_NAME);
 	THREAD* thread = svc_thread_get_current();
-	if (mutex->owner != NULL)
+	//current priority can be already raised by other ceiling mutex, nesting is allowed
+	if (mutex->owned.ceiling != MUTEX_NO_CEILING && thread->base_priority < mutex->owned.ceiling)
+		error(ERROR_SYNC_CEILING_VIOLATION, svc_thread_name(thread));
+	else if (mutex->owner != NULL)
 	{
 		if (mutex->owner != thread)
 		{
@@ -87,6 +101,9 @@ static inline bool svc_mutex_lock(MUTEX* mutex, TIME* time)
 	{
 		mutex->owner = thread;
 		dlist_add_tail((DLIST**)&mutex->owner->owned_mutexes, (DLIST*)mutex);
+		//immediate ceiling protocol: raise owner at once, so nobody, sharing mutex can preempt him
+		if (mutex->owned.ceiling < thread->current_priority)
+			svc_thread_set_current_priority(thread, mutex->owned.ceiling);
 	}
 	//in case of timeout, we will patch result in context by thread_private.c
 	return true;
@@ -119,7 +136,8 @@ void svc_mutex_lock_release(MUTEX* mutex, THREAD* thread)
 	{
 		dlist_remove((DLIST**)&mutex->waiters, (DLIST*)thread);
 		//this can affect on owner priority
-		svc_thread_set_current_priority(mutex->owner, svc_mutex_calculate_owner_priority(mutex->owner));
+		if (mutex->owned.ceiling == MUTEX_NO_CEILING)
+			svc_thread_set_current_priority(mutex->owner, svc_mutex_calculate_owner_priority(mutex->owner));
 		//it's up to caller to decide, wake up thread (timeout, mutex destroy) or not (thread terminate) owned process
 	}
 }
@@ -162,7 +180,7 @@ unsigned int svc_mutex_handler(unsigned int num, unsigned int param1, unsigned i
 	switch (num)
 	{
 	case MUTEX_CREATE:
-		res = (unsigned int)svc_mutex_create();
+		res = (unsigned int)svc_mutex_create(MUTEX_NO_CEILING);
 		break;
 	case MUTEX_LOCK:
 		res = (unsigned int)svc_mutex_lock((MUTEX*)param1, (TIME*)param2);
@@ -173,6 +191,9 @@ unsigned int svc_mutex_handler(unsigned int num, unsigned int param1, unsigned i
 	case MUTEX_DESTROY:
 		svc_mutex_destroy((MUTEX*)param1);
 		break;
+	case MUTEX_CREATE_CEILING:
+		res = (unsigned int)svc_mutex_create(param1);
+		break;
 	default:
 		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
 	}
@@ -31,8 +31,18 @@
 #include "thread_private.h"
 #include "dbg.h"
 
+#define MUTEX_NO_CEILING								((unsigned int)-1)
+
+//entry of thread owned_mutexes list. Waiters of entry are raising owner priority
+//if ceiling is set, owner priority is raised to ceiling instead
 typedef struct {
 	DLIST list;
+	THREAD** waiters;
+	unsigned int ceiling;
+}MUTEX_OWNED;
+
+typedef struct {
+	MUTEX_OWNED owned;
 	MAGIC;
 	//only one item
 	THREAD* owner;
@@ -40,7 +50,9 @@ typedef struct {
 	THREAD* waiters;
 }MUTEX;
 
-//update owner priority according lowest priority of owner's all waiters of all mutexes
+extern const char *const MUTEX_NAME;
+
+//update owner priority according lowest priority of owner's all waiters of all mutexes or ceilings
 //can be called from thread_private.c on base priority update
 //also called internally on mutex unlock
 unsigned int svc_mutex_calculate_owner_priority(THREAD* thread);
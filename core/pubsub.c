@@ -0,0 +1,210 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \addtogroup pubsub publish/subscribe
+	Topic is a sync object for one-to-many messaging. Every message, published
+	to topic, is delivered to all of it's subscribers.
+
+	Message is copied by kernel once into topic slot. Each subscriber is holding
+	own ring of slot indexes, so fan-out cost is not depending on message size.
+	Slot is returned to topic, when last subscriber is readed it.
+
+	Each subscriber has own overflow policy:
+
+	- PUBSUB_BLOCK - publisher is waiting, until subscriber will read message
+	- PUBSUB_DROP_OLDEST - oldest unread message is lost for subscriber
+	- PUBSUB_DROP_NEWEST - published message is lost for subscriber
+
+	Lost messages are counted, and can be read by topic_get_dropped().
+
+	Publisher is also waiting if there is no free slots in topic. To avoid this,
+	slots count must be at least sum of subscribers depth plus 1.
+
+	topic_publish() can be called from IRQ context, only if it will not wait:
+	all subscribers are not PUBSUB_BLOCK and slots count is enough.
+
+	sequence for publisher:
+
+	topic = topic_create(sizeof(MSG), SLOTS);
+	topic_publish*(topic, &msg, <time>);
+
+	sequence for subscriber:
+
+	sub = topic_subscribe(topic, DEPTH, PUBSUB_DROP_OLDEST);
+	for (;;)
+	{
+		topic_read*(sub, &msg, <time>);
+		<process msg>
+	}
+
+	Plese mind, that space for slots is allocated in current thread's memory pool.
+	Subscriber and topic must be destroyed by same thread, that created them.
+	\{
+ */
+
+#include "pubsub.h"
+#include "sys_call.h"
+#include "sys_calls.h"
+
+/**
+	\brief creates topic.
+	\details Mind, that slots will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after topic destruction
+	\param size: message size in bytes
+	\param slots: count of messages, stored in topic
+	\retval topic HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE topic_create(unsigned int size, unsigned int slots)
+{
+	return sys_call(TOPIC_CREATE, size, slots, 0);
+}
+
+/**
+	\brief publish message to all subscribers
+	\param topic: topic handle
+	\param data: message data
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool topic_publish(HANDLE topic, const void* data, TIME* timeout)
+{
+	return sys_call(TOPIC_PUBLISH, (unsigned int)topic, (unsigned int)data, (unsigned int)timeout);
+}
+
+/**
+	\brief publish message to all subscribers
+	\param topic: topic handle
+	\param data: message data
+	\param timeout_ms: timeout in milliseconds
+	\retval true on success, false on timeout
+*/
+bool topic_publish_ms(HANDLE topic, const void* data, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(TOPIC_PUBLISH, (unsigned int)topic, (unsigned int)data, (unsigned int)&timeout);
+}
+
+/**
+	\brief publish message to all subscribers
+	\param topic: topic handle
+	\param data: message data
+	\param timeout_us: timeout in microseconds
+	\retval true on success, false on timeout
+*/
+bool topic_publish_us(HANDLE topic, const void* data, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(TOPIC_PUBLISH, (unsigned int)topic, (unsigned int)data, (unsigned int)&timeout);
+}
+
+/**
+	\brief destroys topic
+	\details All subscribers are destroyed. Waiting publishers and readers are released with false result
+	\param topic: topic handle
+	\retval none
+*/
+void topic_destroy(HANDLE topic)
+{
+	sys_call(TOPIC_DESTROY, (unsigned int)topic, 0, 0);
+}
+
+/**
+	\brief subscribe to topic
+	\details Mind, that ring will be allocated in current thread's memory pool.
+	\param topic: topic handle
+	\param depth: count of unread messages, holded by subscriber. Must be greater 0
+	\param policy: overflow policy
+	\retval subscriber HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE topic_subscribe(HANDLE topic, unsigned int depth, PUBSUB_POLICY policy)
+{
+	return sys_call(TOPIC_SUBSCRIBE, (unsigned int)topic, depth, (unsigned int)policy);
+}
+
+/**
+	\brief read next message
+	\param subscriber: subscriber handle
+	\param data: message data
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool topic_read(HANDLE subscriber, void* data, TIME* timeout)
+{
+	return sys_call(TOPIC_READ, (unsigned int)subscriber, (unsigned int)data, (unsigned int)timeout);
+}
+
+/**
+	\brief read next message
+	\param subscriber: subscriber handle
+	\param data: message data
+	\param timeout_ms: timeout in milliseconds
+	\retval true on success, false on timeout
+*/
+bool topic_read_ms(HANDLE subscriber, void* data, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(TOPIC_READ, (unsigned int)subscriber, (unsigned int)data, (unsigned int)&timeout);
+}
+
+/**
+	\brief read next message
+	\param subscriber: subscriber handle
+	\param data: message data
+	\param timeout_us: timeout in microseconds
+	\retval true on success, false on timeout
+*/
+bool topic_read_us(HANDLE subscriber, void* data, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(TOPIC_READ, (unsigned int)subscriber, (unsigned int)data, (unsigned int)&timeout);
+}
+
+/**
+	\brief get count of messages, lost by subscriber on overflow
+	\param subscriber: subscriber handle
+	\retval dropped messages count
+*/
+unsigned int topic_get_dropped(HANDLE subscriber)
+{
+	return sys_call(TOPIC_GET_DROPPED, (unsigned int)subscriber, 0, 0);
+}
+
+/**
+	\brief unsubscribe from topic
+	\details Unread messages are released. Waiting readers are released with false result
+	\param subscriber: subscriber handle
+	\retval none
+*/
+void topic_unsubscribe(HANDLE subscriber)
+{
+	sys_call(TOPIC_UNSUBSCRIBE, (unsigned int)subscriber, 0, 0);
+}
+
+/** \} */ // end of pubsub group
@@ -0,0 +1,55 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PUBSUB_H
+#define PUBSUB_H
+
+#include "types.h"
+#include "sys_time.h"
+
+typedef enum {
+	//publisher is waiting, while subscriber is full
+	PUBSUB_BLOCK = 0,
+	//oldest unread message of subscriber is lost
+	PUBSUB_DROP_OLDEST,
+	//published message is lost for subscriber
+	PUBSUB_DROP_NEWEST
+} PUBSUB_POLICY;
+
+HANDLE topic_create(unsigned int size, unsigned int slots);
+bool topic_publish(HANDLE topic, const void* data, TIME* timeout);
+bool topic_publish_ms(HANDLE topic, const void* data, unsigned int timeout_ms);
+bool topic_publish_us(HANDLE topic, const void* data, unsigned int timeout_us);
+void topic_destroy(HANDLE topic);
+
+HANDLE topic_subscribe(HANDLE topic, unsigned int depth, PUBSUB_POLICY policy);
+bool topic_read(HANDLE subscriber, void* data, TIME* timeout);
+bool topic_read_ms(HANDLE subscriber, void* data, unsigned int timeout_ms);
+bool topic_read_us(HANDLE subscriber, void* data, unsigned int timeout_us);
+unsigned int topic_get_dropped(HANDLE subscriber);
+void topic_unsubscribe(HANDLE subscriber);
+
+#endif // PUBSUB_H
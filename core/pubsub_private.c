@@ -0,0 +1,353 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pubsub_private.h"
+#include "sys_calls.h"
+#include "mem.h"
+#include "mem_private.h"
+#include "error.h"
+#include "irq.h"
+#include <string.h>
+
+const char *const TOPIC_NAME =								"TOPIC";
+const char *const SUBSCRIBER_NAME =							"SUBSCRIBER";
+
+#define SLOT_DATA(topic, slot)								((void*)((unsigned int)(topic)->mem_block + (slot) * (topic)->size))
+
+static void svc_topic_free_slots(TOPIC* topic)
+{
+	//MUST be called from same thread, same mem pool
+	if (topic->mem_block)
+		free(topic->mem_block);
+	if (topic->refs)
+		free(topic->refs);
+	if (topic->free_slots)
+		free(topic->free_slots);
+}
+
+static inline TOPIC* svc_topic_create(unsigned int size, unsigned int slots)
+{
+	unsigned int i;
+	TOPIC* topic = sys_alloc(sizeof(TOPIC));
+	if (topic == NULL)
+	{
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, TOPIC_NAME);
+		return NULL;
+	}
+	topic->size = size;
+	topic->slots_count = topic->free_count = slots;
+	topic->subscribers = NULL;
+	topic->publishers = NULL;
+	DO_MAGIC(topic, MAGIC_TOPIC);
+	//data blocks are in thread's current mempool
+	topic->mem_block = malloc(slots * size);
+	topic->refs = malloc(slots * sizeof(unsigned int));
+	topic->free_slots = malloc(slots * sizeof(unsigned int));
+	if (topic->mem_block == NULL || topic->refs == NULL || topic->free_slots == NULL)
+	{
+		svc_topic_free_slots(topic);
+		sys_free(topic);
+		error(ERROR_MEM_OUT_OF_HEAP, svc_thread_name(svc_thread_get_current()));
+		return NULL;
+	}
+	for (i = 0; i < slots; ++i)
+	{
+		topic->refs[i] = 0;
+		topic->free_slots[i] = i;
+	}
+	return topic;
+}
+
+static inline bool svc_subscriber_is_full(SUBSCRIBER* sub)
+{
+	return sub->count >= sub->depth;
+}
+
+static unsigned int svc_subscriber_take(SUBSCRIBER* sub)
+{
+	unsigned int slot = sub->slots[sub->head];
+	if (++sub->head >= sub->depth)
+		sub->head = 0;
+	--sub->count;
+	return slot;
+}
+
+static void svc_subscriber_put(SUBSCRIBER* sub, unsigned int slot)
+{
+	unsigned int idx = sub->head + sub->count;
+	if (idx >= sub->depth)
+		idx -= sub->depth;
+	sub->slots[idx] = slot;
+	++sub->count;
+}
+
+static bool svc_topic_can_publish(TOPIC* topic)
+{
+	DLIST_ENUM de;
+	SUBSCRIBER* sub;
+	if (topic->free_count == 0)
+		return false;
+	dlist_enum_start((DLIST**)&topic->subscribers, &de);
+	while (dlist_enum(&de, (DLIST**)&sub))
+		if (sub->policy == PUBSUB_BLOCK && svc_subscriber_is_full(sub))
+			return false;
+	return true;
+}
+
+static void svc_topic_release_slot(TOPIC* topic, unsigned int slot)
+{
+	ASSERT(topic->refs[slot]);
+	if (--topic->refs[slot] == 0)
+		topic->free_slots[topic->free_count++] = slot;
+}
+
+static unsigned int svc_subscriber_pop(SUBSCRIBER* sub, void* data)
+{
+	unsigned int slot = svc_subscriber_take(sub);
+	memcpy(data, SLOT_DATA(sub->topic, slot), sub->topic->size);
+	return slot;
+}
+
+//message is copied once to slot, only slot index is fanned out
+static void svc_topic_publish_data(TOPIC* topic, const void* data)
+{
+	DLIST_ENUM de;
+	SUBSCRIBER* sub;
+	THREAD* thread;
+	unsigned int slot = topic->free_slots[--topic->free_count];
+	memcpy(SLOT_DATA(topic, slot), data, topic->size);
+	//hold slot by publisher, while fanning out
+	topic->refs[slot] = 1;
+	dlist_enum_start((DLIST**)&topic->subscribers, &de);
+	while (dlist_enum(&de, (DLIST**)&sub))
+	{
+		//reader is waiting, subscriber is empty - pass directly
+		if (sub->readers)
+		{
+			thread = sub->readers;
+			dlist_remove_head((DLIST**)&sub->readers);
+			memcpy(thread->sync_param, SLOT_DATA(topic, slot), topic->size);
+			svc_thread_wakeup(thread);
+			continue;
+		}
+		if (svc_subscriber_is_full(sub))
+		{
+			++sub->dropped;
+			if (sub->policy == PUBSUB_DROP_NEWEST)
+				continue;
+			//PUBSUB_DROP_OLDEST. PUBSUB_BLOCK is never full here
+			svc_topic_release_slot(topic, svc_subscriber_take(sub));
+		}
+		svc_subscriber_put(sub, slot);
+		++topic->refs[slot];
+	}
+	svc_topic_release_slot(topic, slot);
+}
+
+static void svc_topic_wake_publishers(TOPIC* topic)
+{
+	THREAD* thread;
+	while (topic->publishers && svc_topic_can_publish(topic))
+	{
+		thread = topic->publishers;
+		dlist_remove_head((DLIST**)&topic->publishers);
+		svc_topic_publish_data(topic, thread->sync_param);
+		svc_thread_wakeup(thread);
+	}
+}
+
+static inline bool svc_topic_publish(TOPIC* topic, const void* data, TIME* time)
+{
+	CHECK_MAGIC(topic, MAGIC_TOPIC, TOPIC_NAME);
+	THREAD* thread;
+	//FIFO order for publishers
+	if (topic->publishers == NULL && svc_topic_can_publish(topic))
+		svc_topic_publish_data(topic, data);
+	else
+	{
+		thread = svc_thread_get_current();
+		//if called from IRQ context, thread_private.c will raise error
+		svc_thread_sleep(time, THREAD_SYNC_TOPIC, topic);
+		thread->sync_param = (void*)data;
+		dlist_add_tail((DLIST**)&topic->publishers, (DLIST*)thread);
+	}
+	return true;
+}
+
+static inline SUBSCRIBER* svc_topic_subscribe(TOPIC* topic, unsigned int depth, PUBSUB_POLICY policy)
+{
+	CHECK_MAGIC(topic, MAGIC_TOPIC, TOPIC_NAME);
+	SUBSCRIBER* sub;
+	//subscriber ring is indexed by depth
+	if (depth == 0)
+	{
+		error_value(ERROR_GENERAL_INVALID_PARAMS, depth);
+		return NULL;
+	}
+	sub = sys_alloc(sizeof(SUBSCRIBER));
+	if (sub == NULL)
+	{
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, SUBSCRIBER_NAME);
+		return NULL;
+	}
+	sub->slots = malloc(depth * sizeof(unsigned int));
+	if (sub->slots == NULL)
+	{
+		sys_free(sub);
+		error(ERROR_MEM_OUT_OF_HEAP, svc_thread_name(svc_thread_get_current()));
+		return NULL;
+	}
+	DO_MAGIC(sub, MAGIC_SUBSCRIBER);
+	sub->topic = topic;
+	sub->policy = policy;
+	sub->depth = depth;
+	sub->head = sub->count = 0;
+	sub->dropped = 0;
+	sub->readers = NULL;
+	dlist_add_tail((DLIST**)&topic->subscribers, (DLIST*)sub);
+	return sub;
+}
+
+static inline bool svc_topic_read(SUBSCRIBER* sub, void* data, TIME* time)
+{
+	CHECK_MAGIC(sub, MAGIC_SUBSCRIBER, SUBSCRIBER_NAME);
+	THREAD* thread;
+	if (sub->count)
+	{
+		svc_topic_release_slot(sub->topic, svc_subscriber_pop(sub, data));
+		svc_topic_wake_publishers(sub->topic);
+	}
+	else
+	{
+		thread = svc_thread_get_current();
+		//if called from IRQ context, thread_private.c will raise error
+		svc_thread_sleep(time, THREAD_SYNC_SUBSCRIBER, sub);
+		thread->sync_param = data;
+		dlist_add_tail((DLIST**)&sub->readers, (DLIST*)thread);
+	}
+	return true;
+}
+
+static inline unsigned int svc_topic_get_dropped(SUBSCRIBER* sub)
+{
+	CHECK_MAGIC(sub, MAGIC_SUBSCRIBER, SUBSCRIBER_NAME);
+	return sub->dropped;
+}
+
+static void svc_topic_wake_all(THREAD** waiters)
+{
+	THREAD* thread;
+	while (*waiters)
+	{
+		thread = *waiters;
+		dlist_remove_head((DLIST**)waiters);
+		//patch return value
+		thread_patch_context(thread, false);
+		svc_thread_wakeup(thread);
+	}
+}
+
+static void svc_subscriber_destroy(SUBSCRIBER* sub)
+{
+	TOPIC* topic = sub->topic;
+	svc_topic_wake_all(&sub->readers);
+	while (sub->count)
+		svc_topic_release_slot(topic, svc_subscriber_take(sub));
+	dlist_remove((DLIST**)&topic->subscribers, (DLIST*)sub);
+	//MUST be called from same thread, same mem pool
+	free(sub->slots);
+	sys_free(sub);
+}
+
+static inline void svc_topic_unsubscribe(SUBSCRIBER* sub)
+{
+	CHECK_MAGIC(sub, MAGIC_SUBSCRIBER, SUBSCRIBER_NAME);
+	TOPIC* topic = sub->topic;
+	svc_subscriber_destroy(sub);
+	//blocking subscriber may be the reason of waiting
+	svc_topic_wake_publishers(topic);
+}
+
+static inline void svc_topic_destroy(TOPIC* topic)
+{
+	CHECK_MAGIC(topic, MAGIC_TOPIC, TOPIC_NAME);
+	while (topic->subscribers)
+		svc_subscriber_destroy(topic->subscribers);
+	svc_topic_wake_all(&topic->publishers);
+	svc_topic_free_slots(topic);
+	sys_free(topic);
+}
+
+void svc_topic_lock_release(TOPIC* topic, THREAD* thread)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CHECK_MAGIC(topic, MAGIC_TOPIC, TOPIC_NAME);
+	dlist_remove((DLIST**)&topic->publishers, (DLIST*)thread);
+	//next publisher may fit now
+	svc_topic_wake_publishers(topic);
+}
+
+void svc_subscriber_lock_release(SUBSCRIBER* sub, THREAD* thread)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CHECK_MAGIC(sub, MAGIC_SUBSCRIBER, SUBSCRIBER_NAME);
+	dlist_remove((DLIST**)&sub->readers, (DLIST*)thread);
+}
+
+unsigned int svc_pubsub_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CRITICAL_ENTER;
+	unsigned int res = 0;
+	switch (num)
+	{
+	case TOPIC_CREATE:
+		res = (unsigned int)svc_topic_create(param1, param2);
+		break;
+	case TOPIC_PUBLISH:
+		res = (unsigned int)svc_topic_publish((TOPIC*)param1, (const void*)param2, (TIME*)param3);
+		break;
+	case TOPIC_DESTROY:
+		svc_topic_destroy((TOPIC*)param1);
+		break;
+	case TOPIC_SUBSCRIBE:
+		res = (unsigned int)svc_topic_subscribe((TOPIC*)param1, param2, (PUBSUB_POLICY)param3);
+		break;
+	case TOPIC_READ:
+		res = (unsigned int)svc_topic_read((SUBSCRIBER*)param1, (void*)param2, (TIME*)param3);
+		break;
+	case TOPIC_GET_DROPPED:
+		res = svc_topic_get_dropped((SUBSCRIBER*)param1);
+		break;
+	case TOPIC_UNSUBSCRIBE:
+		svc_topic_unsubscribe((SUBSCRIBER*)param1);
+		break;
+	default:
+		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
+	}
+	CRITICAL_LEAVE;
+	return res;
+}
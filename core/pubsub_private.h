@@ -0,0 +1,72 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PUBSUB_PRIVATE_H
+#define PUBSUB_PRIVATE_H
+
+#include "dlist.h"
+#include "thread_private.h"
+#include "pubsub.h"
+#include "dbg.h"
+
+typedef struct _TOPIC TOPIC;
+
+typedef struct {
+	DLIST list;
+	MAGIC;
+	TOPIC* topic;
+	PUBSUB_POLICY policy;
+	//ring of slot indexes, head is oldest, wrapped at depth
+	unsigned int* slots;
+	unsigned int depth;
+	unsigned int head, count;
+	unsigned int dropped;
+	//list, data buffer in sync_param
+	THREAD* readers;
+}SUBSCRIBER;
+
+struct _TOPIC {
+	MAGIC;
+	unsigned int size;
+	unsigned int slots_count;
+	void* mem_block;
+	//references of subscribers on every slot
+	unsigned int* refs;
+	//stack of free slots indexes
+	unsigned int* free_slots;
+	unsigned int free_count;
+	SUBSCRIBER* subscribers;
+	//list, data in sync_param
+	THREAD* publishers;
+};
+
+//called from thread_private.c on destroy or timeout
+void svc_topic_lock_release(TOPIC* topic, THREAD* thread);
+void svc_subscriber_lock_release(SUBSCRIBER* sub, THREAD* thread);
+
+unsigned int svc_pubsub_handler(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3);
+
+#endif // PUBSUB_PRIVATE_H
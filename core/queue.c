@@ -43,6 +43,9 @@
 	<process buf object>
 	queue_release_buffer(queue, buf);
 
+	For bulk transfers queue_allocate_buffers*, queue_push_buffers, queue_pull_buffers*
+	and queue_release_buffers can be used. They process many buffers by single system call.
+
 	Plese mind, that space for data queue is allocated in current thread's
 	memory pool.
 
@@ -84,6 +87,23 @@ HANDLE queue_create_aligned(unsigned int block_size, unsigned int blocks_count,
 	return sys_call(QUEUE_CREATE, block_size, blocks_count, align);
 }
 
+/**
+	\brief creates queue object with ring layout.
+	\details Blocks are placed contiguous in memory, without list header, so memory overhead
+	is only block align. Mind, that blocks must be pushed in same order, as allocated,
+	and released in same order, as pulled. Usually it's true for single producer and single consumer.
+	Data block will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after queue destruction.
+	\param block_size: size of single memory block in bytes
+	\param blocks_count: count of allocated blocks
+	\param align: block align. Must be multiples of	WORD_SIZE() and greater 0.
+	\retval queue HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE queue_create_ring(unsigned int block_size, unsigned int blocks_count, unsigned int align)
+{
+	return sys_call(QUEUE_CREATE_RING, block_size, blocks_count, align);
+}
+
 /**
 	\brief allocate buffer in queue.
 	\param queue: data queue
@@ -180,6 +200,137 @@ void queue_release_buffer(HANDLE queue, void* buf)
 	sys_call(QUEUE_RELEASE_BUFFER, (unsigned int)queue, (unsigned int)buf, 0);
 }
 
+static unsigned int queue_batch(unsigned int num, HANDLE queue, void** bufs, unsigned int min, unsigned int max, TIME* timeout)
+{
+	QUEUE_BATCH batch;
+	batch.bufs = bufs;
+	batch.count = 0;
+	batch.min = min;
+	batch.max = max;
+	sys_call(num, (unsigned int)queue, (unsigned int)&batch, (unsigned int)timeout);
+	return batch.count;
+}
+
+/**
+	\brief allocate many buffers in queue by single call.
+	\details Thread is waked up only when at least min buffers are allocated. On timeout
+	already allocated buffers are kept. If min is 0, call never waits.
+	\param queue: data queue
+	\param bufs: array for allocated buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to allocate
+	\param timeout: pointer to TIME structure
+	\retval count of allocated buffers
+*/
+unsigned int queue_allocate_buffers(HANDLE queue, void** bufs, unsigned int min, unsigned int max, TIME* timeout)
+{
+	return queue_batch(QUEUE_ALLOCATE_BUFFERS, queue, bufs, min, max, timeout);
+}
+
+/**
+	\brief allocate many buffers in queue by single call.
+	\param queue: data queue
+	\param bufs: array for allocated buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to allocate
+	\param timeout_ms: timeout in milliseconds
+	\retval count of allocated buffers
+*/
+unsigned int queue_allocate_buffers_ms(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return queue_batch(QUEUE_ALLOCATE_BUFFERS, queue, bufs, min, max, &timeout);
+}
+
+/**
+	\brief allocate many buffers in queue by single call.
+	\param queue: data queue
+	\param bufs: array for allocated buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to allocate
+	\param timeout_us: timeout in microseconds
+	\retval count of allocated buffers
+*/
+unsigned int queue_allocate_buffers_us(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return queue_batch(QUEUE_ALLOCATE_BUFFERS, queue, bufs, min, max, &timeout);
+}
+
+/**
+	\brief push many buffers to queue by single call.
+	\param queue: data queue
+	\param bufs: buffers to push
+	\param count: count of buffers
+	\retval none
+*/
+void queue_push_buffers(HANDLE queue, void** bufs, unsigned int count)
+{
+	sys_call(QUEUE_PUSH_BUFFERS, (unsigned int)queue, (unsigned int)bufs, count);
+}
+
+/**
+	\brief pull many buffers from queue by single call.
+	\details Thread is waked up only when at least min buffers are pulled. On timeout
+	already pulled buffers are kept. If min is 0, call never waits.
+	\param queue: data queue
+	\param bufs: array for pulled buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to pull
+	\param timeout: pointer to TIME structure
+	\retval count of pulled buffers
+*/
+unsigned int queue_pull_buffers(HANDLE queue, void** bufs, unsigned int min, unsigned int max, TIME* timeout)
+{
+	return queue_batch(QUEUE_PULL_BUFFERS, queue, bufs, min, max, timeout);
+}
+
+/**
+	\brief pull many buffers from queue by single call.
+	\param queue: data queue
+	\param bufs: array for pulled buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to pull
+	\param timeout_ms: timeout in milliseconds
+	\retval count of pulled buffers
+*/
+unsigned int queue_pull_buffers_ms(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return queue_batch(QUEUE_PULL_BUFFERS, queue, bufs, min, max, &timeout);
+}
+
+/**
+	\brief pull many buffers from queue by single call.
+	\param queue: data queue
+	\param bufs: array for pulled buffers, at least max entries
+	\param min: minimal count of buffers to wait for
+	\param max: maximal count of buffers to pull
+	\param timeout_us: timeout in microseconds
+	\retval count of pulled buffers
+*/
+unsigned int queue_pull_buffers_us(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return queue_batch(QUEUE_PULL_BUFFERS, queue, bufs, min, max, &timeout);
+}
+
+/**
+	\brief release many buffers by single call.
+	\param queue: data queue
+	\param bufs: buffers to release
+	\param count: count of buffers
+	\retval none
+*/
+void queue_release_buffers(HANDLE queue, void** bufs, unsigned int count)
+{
+	sys_call(QUEUE_RELEASE_BUFFERS, (unsigned int)queue, (unsigned int)bufs, count);
+}
+
 /**
 	\brief check if queue is empty
 	\param queue: data queue
@@ -217,9 +368,14 @@ void queue_destroy(HANDLE queue)
 	from one thread to another.
 
 	Basically, message queue is \ref data_queue, with data object size
-	of WORD_SIZE() and simplified interface. All \ref data_queue functions
+	of WORD_SIZE() (or multiple words) and simplified interface. Messages are copied
+	inside of kernel by single call. All \ref data_queue functions
 	can be used for advanced functionality.
 
+	Message queue, created by messages_create_ring, uses ring layout, so no list header
+	per message is required. \ref data_queue functions must not be mixed with
+	messages_post and messages_peek on such queue.
+
 	Plese mind, that space for message queue is allocated in current thread's
 	memory pool.
 
@@ -243,6 +399,35 @@ HANDLE messages_create(unsigned int messages_count)
 	return sys_call(QUEUE_CREATE, sizeof(unsigned int), messages_count, WORD_SIZE);
 }
 
+/**
+	\brief creates message queue object with multi-word messages.
+	\details Mind, that data block will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after queue destruction
+	\param messages_count: maximal messages count
+	\param words: size of message in words
+	\retval message queue HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE messages_create_words(unsigned int messages_count, unsigned int words)
+{
+	return sys_call(QUEUE_CREATE, words * WORD_SIZE, messages_count, WORD_SIZE);
+}
+
+/**
+	\brief creates message queue object with ring layout.
+	\details Messages are copied inline in queue ring, without list header per message.
+	Use only messages_post* and messages_peek* on this queue, \ref data_queue buffer functions
+	must not be mixed with them.
+	Mind, that data block will be allocated in current thread's memory pool.
+	This memory pool can be destroyed only after queue destruction
+	\param messages_count: maximal messages count
+	\param words: size of message in words
+	\retval message queue HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE messages_create_ring(unsigned int messages_count, unsigned int words)
+{
+	return sys_call(QUEUE_CREATE_RING, words * WORD_SIZE, messages_count, WORD_SIZE);
+}
+
 /**
 	\brief post message
 	\param messages: message queue
@@ -252,13 +437,7 @@ HANDLE messages_create(unsigned int messages_count)
 */
 bool messages_post(HANDLE messages, unsigned int message, TIME* timeout)
 {
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_ALLOCATE_BUFFER, (unsigned int)messages, (unsigned int)timeout, 0);
-	if (buf)
-	{
-		*buf = message;
-		sys_call(QUEUE_PUSH, (unsigned int)messages, (unsigned int)buf, 0);
-	}
-	return buf != NULL;
+	return sys_call(QUEUE_POST, (unsigned int)messages, (unsigned int)&message, (unsigned int)timeout);
 }
 
 /**
@@ -272,13 +451,7 @@ bool messages_post_ms(HANDLE messages, unsigned int message, unsigned int timeou
 {
 	TIME timeout;
 	ms_to_time(timeout_ms, &timeout);
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_ALLOCATE_BUFFER, (unsigned int)messages, (unsigned int)&timeout, 0);
-	if (buf)
-	{
-		*buf = message;
-		sys_call(QUEUE_PUSH, (unsigned int)messages, (unsigned int)buf, 0);
-	}
-	return buf != NULL;
+	return sys_call(QUEUE_POST, (unsigned int)messages, (unsigned int)&message, (unsigned int)&timeout);
 }
 
 /**
@@ -292,13 +465,19 @@ bool messages_post_us(HANDLE messages, unsigned int message, unsigned int timeou
 {
 	TIME timeout;
 	us_to_time(timeout_us, &timeout);
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_ALLOCATE_BUFFER, (unsigned int)messages, (unsigned int)&timeout, 0);
-	if (buf)
-	{
-		*buf = message;
-		sys_call(QUEUE_PUSH, (unsigned int)messages, (unsigned int)buf, 0);
-	}
-	return buf != NULL;
+	return sys_call(QUEUE_POST, (unsigned int)messages, (unsigned int)&message, (unsigned int)&timeout);
+}
+
+/**
+	\brief post multi-word message
+	\param messages: message queue, created by \ref messages_create_words or \ref messages_create_ring
+	\param message: pointer to message to post
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool messages_post_words(HANDLE messages, unsigned int* message, TIME* timeout)
+{
+	return sys_call(QUEUE_POST, (unsigned int)messages, (unsigned int)message, (unsigned int)timeout);
 }
 
 /**
@@ -309,13 +488,8 @@ bool messages_post_us(HANDLE messages, unsigned int message, unsigned int timeou
 */
 unsigned int messages_peek(HANDLE messages, TIME* timeout)
 {
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_PULL, (unsigned int)messages, (unsigned int)timeout, 0);
 	unsigned int message = 0;
-	if (buf)
-	{
-		message = *buf;
-		sys_call(QUEUE_RELEASE_BUFFER, (unsigned int)messages, (unsigned int)buf, 0);
-	}
+	sys_call(QUEUE_PEEK, (unsigned int)messages, (unsigned int)&message, (unsigned int)timeout);
 	return message;
 }
 
@@ -328,14 +502,9 @@ unsigned int messages_peek(HANDLE messages, TIME* timeout)
 unsigned int messages_peek_ms(HANDLE messages, unsigned int timeout_ms)
 {
 	TIME timeout;
-	ms_to_time(timeout_ms, &timeout);
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_PULL, (unsigned int)messages, (unsigned int)&timeout, 0);
 	unsigned int message = 0;
-	if (buf)
-	{
-		message = *buf;
-		sys_call(QUEUE_RELEASE_BUFFER, (unsigned int)messages, (unsigned int)buf, 0);
-	}
+	ms_to_time(timeout_ms, &timeout);
+	sys_call(QUEUE_PEEK, (unsigned int)messages, (unsigned int)&message, (unsigned int)&timeout);
 	return message;
 }
 
@@ -348,15 +517,22 @@ unsigned int messages_peek_ms(HANDLE messages, unsigned int timeout_ms)
 unsigned int messages_peek_us(HANDLE messages, unsigned int timeout_us)
 {
 	TIME timeout;
-	us_to_time(timeout_us, &timeout);
-	unsigned int* buf = (unsigned int*)sys_call(QUEUE_PULL, (unsigned int)messages, (unsigned int)&timeout, 0);
 	unsigned int message = 0;
-	if (buf)
-	{
-		message = *buf;
-		sys_call(QUEUE_RELEASE_BUFFER, (unsigned int)messages, (unsigned int)buf, 0);
-	}
+	us_to_time(timeout_us, &timeout);
+	sys_call(QUEUE_PEEK, (unsigned int)messages, (unsigned int)&message, (unsigned int)&timeout);
 	return message;
 }
 
+/**
+	\brief peek multi-word message
+	\param messages: message queue, created by \ref messages_create_words or \ref messages_create_ring
+	\param message: pointer to buffer for message
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool messages_peek_words(HANDLE messages, unsigned int* message, TIME* timeout)
+{
+	return sys_call(QUEUE_PEEK, (unsigned int)messages, (unsigned int)message, (unsigned int)timeout);
+}
+
 /** \} */ // end of message_queue group
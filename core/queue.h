@@ -35,8 +35,16 @@
 #include "time.h"
 #include "types.h"
 
+typedef struct {
+	void** bufs;
+	unsigned int count;
+	unsigned int min;
+	unsigned int max;
+} QUEUE_BATCH;
+
 HANDLE queue_create(unsigned int block_size, unsigned int blocks_count);
 HANDLE queue_create_aligned(unsigned int block_size, unsigned int blocks_count, unsigned int align);
+HANDLE queue_create_ring(unsigned int block_size, unsigned int blocks_count, unsigned int align);
 void* queue_allocate_buffer(HANDLE queue, TIME* timeout);
 void* queue_allocate_buffer_ms(HANDLE queue, unsigned int timeout_ms);
 void* queue_allocate_buffer_us(HANDLE queue, unsigned int timeout_us);
@@ -47,15 +55,27 @@ void* queue_pull_us(HANDLE queue, unsigned int timeout_us);
 bool queue_is_empty(HANDLE queue);
 bool queue_is_full(HANDLE queue);
 void queue_release_buffer(HANDLE queue, void* buf);
+unsigned int queue_allocate_buffers(HANDLE queue, void** bufs, unsigned int min, unsigned int max, TIME* timeout);
+unsigned int queue_allocate_buffers_ms(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_ms);
+unsigned int queue_allocate_buffers_us(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_us);
+void queue_push_buffers(HANDLE queue, void** bufs, unsigned int count);
+unsigned int queue_pull_buffers(HANDLE queue, void** bufs, unsigned int min, unsigned int max, TIME* timeout);
+unsigned int queue_pull_buffers_ms(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_ms);
+unsigned int queue_pull_buffers_us(HANDLE queue, void** bufs, unsigned int min, unsigned int max, unsigned int timeout_us);
+void queue_release_buffers(HANDLE queue, void** bufs, unsigned int count);
 void queue_destroy(HANDLE queue);
 
 HANDLE messages_create(unsigned int messages_count);
+HANDLE messages_create_words(unsigned int messages_count, unsigned int words);
+HANDLE messages_create_ring(unsigned int messages_count, unsigned int words);
 bool messages_post(HANDLE messages, unsigned int message, TIME* timeout);
 bool messages_post_ms(HANDLE messages, unsigned int message, unsigned int timeout_ms);
 bool messages_post_us(HANDLE messages, unsigned int message, unsigned int timeout_us);
+bool messages_post_words(HANDLE messages, unsigned int* message, TIME* timeout);
 unsigned int messages_peek(HANDLE messages, TIME* timeout);
 unsigned int messages_peek_ms(HANDLE messages, unsigned int timeout_ms);
 unsigned int messages_peek_us(HANDLE messages, unsigned int timeout_us);
+bool messages_peek_words(HANDLE messages, unsigned int* message, TIME* timeout);
 
 #define messages_is_empty		queue_is_empty
 #define messages_is_full		queue_is_full
@@ -31,6 +31,7 @@
 #include "mem_private.h"
 #include "irq.h"
 #include "error.h"
+#include <string.h>
 
 const char *const QUEUE_NAME =							"QUEUE";
 
@@ -48,7 +49,10 @@ static inline QUEUE* svc_queue_create(unsigned int block_size, unsigned int bloc
 		queue = sys_alloc(sizeof(QUEUE));
 		if (queue != NULL)
 		{
+			queue->ring = false;
 			queue->align_offset = align_offset;
+			queue->block_size = block_size;
+			queue->blocks_count = blocks_count;
 			queue->mem_block = mem_block;
 			queue->pull_waiters = NULL;
 			queue->push_waiters = NULL;
@@ -71,90 +75,322 @@ static inline QUEUE* svc_queue_create(unsigned int block_size, unsigned int bloc
 	return queue;
 }
 
-static inline void* svc_queue_allocate_buffer(QUEUE* queue, TIME* time)
+static inline QUEUE* svc_queue_create_ring(unsigned int block_size, unsigned int blocks_count, unsigned int align)
 {
-	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+	QUEUE* queue = NULL;
+	if (align == 0)
+	{
+		error_value(ERROR_GENERAL_INVALID_PARAMS, align);
+		return NULL;
+	}
+	//round block to align. No list header is required
+	unsigned int stride = (block_size + align - 1) / align * align;
+	void* mem_block = malloc_aligned(blocks_count * stride, align);
+	if (mem_block)
+	{
+		queue = sys_alloc(sizeof(QUEUE));
+		if (queue != NULL)
+		{
+			queue->ring = true;
+			queue->align_offset = stride;
+			queue->mem_block = mem_block;
+			queue->pull_waiters = NULL;
+			queue->push_waiters = NULL;
+			queue->free_blocks = NULL;
+			queue->filled_blocks = NULL;
+			queue->block_size = block_size;
+			queue->blocks_count = blocks_count;
+			queue->alloc_pos = queue->pull_pos = 0;
+			queue->free_count = blocks_count;
+			queue->filled_count = 0;
+			DO_MAGIC(queue, MAGIC_QUEUE);
+		}
+		else
+		{
+			free(mem_block);
+			fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, QUEUE_NAME);
+		}
+	}
+	else
+		error(ERROR_MEM_OUT_OF_HEAP, svc_thread_name(svc_thread_get_current()));
 
+	return queue;
+}
+
+//for ring layout align_offset is block stride
+#define RING_BLOCK(queue, pos)			((void*)((unsigned int)((queue)->mem_block) + (pos) * (queue)->align_offset))
+#define RING_NEXT(queue, pos)				((pos) + 1 >= (queue)->blocks_count ? 0 : (pos) + 1)
+#define RING_ADD(queue, pos, cnt)		((pos) + (cnt) >= (queue)->blocks_count ? (pos) + (cnt) - (queue)->blocks_count : (pos) + (cnt))
+
+static inline void* svc_queue_take_free(QUEUE* queue)
+{
 	void* res = NULL;
-	THREAD* thread = svc_thread_get_current();
-	if (queue->free_blocks)
+	if (queue->ring)
+	{
+		if (queue->free_count)
+		{
+			res = RING_BLOCK(queue, queue->alloc_pos);
+			queue->alloc_pos = RING_NEXT(queue, queue->alloc_pos);
+			--queue->free_count;
+		}
+	}
+	else if (queue->free_blocks)
 	{
 		res = (void*)((unsigned int)(queue->free_blocks) + queue->align_offset);
 		dlist_remove_head(&queue->free_blocks);
 	}
-	else
+	return res;
+}
+
+static inline void* svc_queue_take_filled(QUEUE* queue)
+{
+	void* res = NULL;
+	if (queue->ring)
 	{
-		//first - remove from active list
-		//if called from IRQ context, thread_private.c will raise error
-		svc_thread_sleep(time, THREAD_SYNC_QUEUE, queue);
-		dlist_add_tail((DLIST**)&queue->push_waiters, (DLIST*)thread);
+		if (queue->filled_count)
+		{
+			res = RING_BLOCK(queue, queue->pull_pos);
+			queue->pull_pos = RING_NEXT(queue, queue->pull_pos);
+			--queue->filled_count;
+		}
+	}
+	else if (queue->filled_blocks)
+	{
+		res = (void*)((unsigned int)(queue->filled_blocks) + queue->align_offset);
+		dlist_remove_head(&queue->filled_blocks);
 	}
 	return res;
 }
 
-static inline void svc_queue_push(QUEUE* queue, void* buf)
+//give buffer to first waiter. Batch waiter is woken only when it has at least min buffers
+static inline void svc_queue_handoff(THREAD** waiters, void* buf)
+{
+	THREAD* thread = *waiters;
+	if (svc_thread_sync_type(thread) == THREAD_SYNC_QUEUE_BATCH)
+	{
+		QUEUE_BATCH* batch = (QUEUE_BATCH*)thread->sync_param;
+		batch->bufs[batch->count++] = buf;
+		if (batch->count < batch->min)
+			return;
+	}
+	//patch return value
+	else
+		thread_patch_context(thread, (unsigned int)buf);
+	dlist_remove_head((DLIST**)waiters);
+	svc_thread_wakeup(thread);
+}
+
+static void svc_queue_release_buffer(QUEUE* queue, void* buf);
+
+//ring layout requires blocks to be pushed in allocation order and released in pull order
+static void svc_queue_push(QUEUE* queue, void* buf)
 {
 	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
 
+	if (queue->ring)
+	{
+		ASSERT(buf == RING_BLOCK(queue, RING_ADD(queue, queue->pull_pos, queue->filled_count)));
+	}
 	if (queue->pull_waiters)
 	{
 		THREAD* thread = queue->pull_waiters;
-		dlist_remove_head((DLIST**)&queue->pull_waiters);
-		//patch return value
-		thread_patch_context(thread, (unsigned int)buf);
-		svc_thread_wakeup(thread);
+		if (queue->ring)
+			queue->pull_pos = RING_NEXT(queue, queue->pull_pos);
+		//waiter on messages peek. Copy and release at once
+		if (svc_thread_sync_type(thread) == THREAD_SYNC_QUEUE && thread->sync_param)
+		{
+			dlist_remove_head((DLIST**)&queue->pull_waiters);
+			memcpy(thread->sync_param, buf, queue->block_size);
+			svc_queue_release_buffer(queue, buf);
+			svc_thread_wakeup(thread);
+		}
+		else
+			svc_queue_handoff(&queue->pull_waiters, buf);
 	}
+	else if (queue->ring)
+		++queue->filled_count;
 	else
 		dlist_add_tail(&queue->filled_blocks, (DLIST*)((unsigned int)buf - queue->align_offset));
 }
 
+static void svc_queue_release_buffer(QUEUE* queue, void* buf)
+{
+	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
 
-static inline void* svc_queue_pull(QUEUE* queue, TIME* time)
+	if (queue->ring)
+	{
+		ASSERT(buf == RING_BLOCK(queue, RING_ADD(queue, queue->alloc_pos, queue->free_count)));
+	}
+	if (queue->push_waiters)
+	{
+		THREAD* thread = queue->push_waiters;
+		//queue is full, so released block is the next to allocate
+		if (queue->ring)
+			queue->alloc_pos = RING_NEXT(queue, queue->alloc_pos);
+		//waiter on messages post. Copy and push at once
+		if (svc_thread_sync_type(thread) == THREAD_SYNC_QUEUE && thread->sync_param)
+		{
+			dlist_remove_head((DLIST**)&queue->push_waiters);
+			memcpy(buf, thread->sync_param, queue->block_size);
+			svc_queue_push(queue, buf);
+			svc_thread_wakeup(thread);
+		}
+		else
+			svc_queue_handoff(&queue->push_waiters, buf);
+	}
+	else if (queue->ring)
+		++queue->free_count;
+	else
+		dlist_add_tail(&queue->free_blocks, (DLIST*)((unsigned int)buf - queue->align_offset));
+}
+
+static inline void* svc_queue_allocate_buffer(QUEUE* queue, TIME* time)
 {
 	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
 
-	void* res = NULL;
 	THREAD* thread = svc_thread_get_current();
-	if (queue->filled_blocks)
+	void* res = svc_queue_take_free(queue);
+	if (res == NULL)
 	{
-		res = (void*)((unsigned int)(queue->filled_blocks) + queue->align_offset);
-		dlist_remove_head(&queue->filled_blocks);
+		//first - remove from active list
+		//if called from IRQ context, thread_private.c will raise error
+		svc_thread_sleep(time, THREAD_SYNC_QUEUE, queue);
+		thread->sync_param = NULL;
+		dlist_add_tail((DLIST**)&queue->push_waiters, (DLIST*)thread);
 	}
-	else
+	return res;
+}
+
+
+static inline void* svc_queue_pull(QUEUE* queue, TIME* time)
+{
+	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+
+	THREAD* thread = svc_thread_get_current();
+	void* res = svc_queue_take_filled(queue);
+	if (res == NULL)
 	{
 		//first - remove from active list
 		//if called from IRQ context, thread_private.c will raise error
 		svc_thread_sleep(time, THREAD_SYNC_QUEUE, queue);
+		thread->sync_param = NULL;
 		dlist_add_tail((DLIST**)&queue->pull_waiters, (DLIST*)thread);
 	}
 	return res;
 }
 
-static inline void svc_queue_release_buffer(QUEUE* queue, void* buf)
+static inline bool svc_queue_batch_wait(QUEUE* queue, QUEUE_BATCH* batch, TIME* time, THREAD** waiters)
+{
+	THREAD* thread = svc_thread_get_current();
+	//min == 0 means "don't wait"
+	if (batch->count < batch->min)
+	{
+		//already taken buffers are kept in batch, rest will be added on handoff
+		svc_thread_sleep(time, THREAD_SYNC_QUEUE_BATCH, queue);
+		thread->sync_param = batch;
+		dlist_add_tail((DLIST**)waiters, (DLIST*)thread);
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+static inline bool svc_queue_allocate_buffers(QUEUE* queue, QUEUE_BATCH* batch, TIME* time)
 {
 	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
 
-	if (queue->push_waiters)
+	void* buf;
+	if (batch->min > batch->max)
+		batch->min = batch->max;
+	batch->count = 0;
+	while (batch->count < batch->max && (buf = svc_queue_take_free(queue)) != NULL)
+		batch->bufs[batch->count++] = buf;
+	return svc_queue_batch_wait(queue, batch, time, &queue->push_waiters);
+}
+
+static inline bool svc_queue_pull_buffers(QUEUE* queue, QUEUE_BATCH* batch, TIME* time)
+{
+	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+
+	void* buf;
+	if (batch->min > batch->max)
+		batch->min = batch->max;
+	batch->count = 0;
+	while (batch->count < batch->max && (buf = svc_queue_take_filled(queue)) != NULL)
+		batch->bufs[batch->count++] = buf;
+	return svc_queue_batch_wait(queue, batch, time, &queue->pull_waiters);
+}
+
+static inline void svc_queue_push_buffers(QUEUE* queue, void** bufs, unsigned int count)
+{
+	unsigned int i;
+	for (i = 0; i < count; ++i)
+		svc_queue_push(queue, bufs[i]);
+}
+
+static inline void svc_queue_release_buffers(QUEUE* queue, void** bufs, unsigned int count)
+{
+	unsigned int i;
+	for (i = 0; i < count; ++i)
+		svc_queue_release_buffer(queue, bufs[i]);
+}
+
+static inline bool svc_queue_post(QUEUE* queue, void* data, TIME* time)
+{
+	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+
+	THREAD* thread = svc_thread_get_current();
+	void* buf = svc_queue_take_free(queue);
+	if (buf)
 	{
-		THREAD* thread = queue->push_waiters;
-		dlist_remove_head((DLIST**)&queue->push_waiters);
-		//patch return value
-		thread_patch_context(thread, (unsigned int)buf);
-		svc_thread_wakeup(thread);
+		memcpy(buf, data, queue->block_size);
+		svc_queue_push(queue, buf);
 	}
 	else
-		dlist_add_tail(&queue->free_blocks, (DLIST*)((unsigned int)buf - queue->align_offset));
+	{
+		//data will be copied on release by consumer
+		svc_thread_sleep(time, THREAD_SYNC_QUEUE, queue);
+		thread->sync_param = data;
+		dlist_add_tail((DLIST**)&queue->push_waiters, (DLIST*)thread);
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+static inline bool svc_queue_peek(QUEUE* queue, void* data, TIME* time)
+{
+	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+
+	THREAD* thread = svc_thread_get_current();
+	void* buf = svc_queue_take_filled(queue);
+	if (buf)
+	{
+		memcpy(data, buf, queue->block_size);
+		svc_queue_release_buffer(queue, buf);
+	}
+	else
+	{
+		//data will be copied on push by producer
+		svc_thread_sleep(time, THREAD_SYNC_QUEUE, queue);
+		thread->sync_param = data;
+		dlist_add_tail((DLIST**)&queue->pull_waiters, (DLIST*)thread);
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
 }
 
 static inline bool svc_queue_is_empty(QUEUE* queue)
 {
 	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+	if (queue->ring)
+		return queue->filled_count == 0;
 	return queue->filled_blocks == NULL ? true : false;
 }
 
 static inline bool svc_queue_is_full(QUEUE* queue)
 {
 	CHECK_MAGIC(queue, MAGIC_QUEUE, QUEUE_NAME);
+	if (queue->ring)
+		return queue->free_count == 0;
 	return queue->free_blocks == NULL ? true : false;
 }
 
@@ -181,7 +417,7 @@ static inline void svc_queue_destroy(QUEUE* queue)
 		thread = queue->push_waiters;
 		dlist_remove_head((DLIST**)&queue->push_waiters);
 		//patch return value
-		thread_patch_context(thread, NULL);
+		thread_patch_context(thread, 0);
 		svc_thread_wakeup(thread);
 	}
 	while (queue->pull_waiters)
@@ -189,7 +425,7 @@ static inline void svc_queue_destroy(QUEUE* queue)
 		thread = queue->pull_waiters;
 		dlist_remove_head((DLIST**)&queue->pull_waiters);
 		//patch return value
-		thread_patch_context(thread, NULL);
+		thread_patch_context(thread, 0);
 		svc_thread_wakeup(thread);
 	}
 	//MUST be called from same thread, same mem pool
@@ -228,6 +464,27 @@ unsigned int svc_queue_handler(unsigned int num, unsigned int param1, unsigned i
 	case QUEUE_DESTROY:
 		svc_queue_destroy((QUEUE*)param1);
 		break;
+	case QUEUE_CREATE_RING:
+		res = (unsigned int)svc_queue_create_ring(param1, param2, param3);
+		break;
+	case QUEUE_POST:
+		res = (unsigned int)svc_queue_post((QUEUE*)param1, (void*)param2, (TIME*)param3);
+		break;
+	case QUEUE_PEEK:
+		res = (unsigned int)svc_queue_peek((QUEUE*)param1, (void*)param2, (TIME*)param3);
+		break;
+	case QUEUE_ALLOCATE_BUFFERS:
+		res = (unsigned int)svc_queue_allocate_buffers((QUEUE*)param1, (QUEUE_BATCH*)param2, (TIME*)param3);
+		break;
+	case QUEUE_PUSH_BUFFERS:
+		svc_queue_push_buffers((QUEUE*)param1, (void**)param2, param3);
+		break;
+	case QUEUE_PULL_BUFFERS:
+		res = (unsigned int)svc_queue_pull_buffers((QUEUE*)param1, (QUEUE_BATCH*)param2, (TIME*)param3);
+		break;
+	case QUEUE_RELEASE_BUFFERS:
+		svc_queue_release_buffers((QUEUE*)param1, (void**)param2, param3);
+		break;
 	default:
 		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
 	}
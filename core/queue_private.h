@@ -30,6 +30,7 @@
 #include "thread_private.h"
 #include "dbg.h"
 #include "dlist.h"
+#include "queue.h"
 
 typedef struct {
 	MAGIC;
@@ -39,6 +40,10 @@ typedef struct {
 	DLIST* filled_blocks;
 	THREAD* push_waiters;
 	THREAD* pull_waiters;
+	//ring layout: blocks are contiguous, without list header
+	bool ring;
+	unsigned int block_size, blocks_count;
+	unsigned int alloc_pos, pull_pos, free_count, filled_count;
 }QUEUE;
 
 //called from thread_private.c on destroy or timeout
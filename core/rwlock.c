@@ -0,0 +1,164 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \addtogroup rwlock rwlock
+	rwlock is a sync object. It's used for shared read and exclusive
+	write object access.
+
+	Many threads can own rwlock by rwlock_read_lock() at same time. Maximum
+	count of readers is set on rwlock_create(). Only one thread can own
+	rwlock by rwlock_write_lock(), while no readers are owning it.
+
+	Waiters are served in FIFO order. If writer is waiting, new readers are
+	put in waiting state too, so writers are not starving.
+
+	Like mutex, rwlock is using priority inheritance: if higher priority
+	thread is waiting for rwlock, priority of writer or all readers
+	is temporaily raised to caller's priority.
+
+	Recursive locking is not supported.
+
+	Because rwlock locking can put current thread in waiting state, rwlock
+	locking/unlocking can be called only from SYSTEM/USER contex
+	\{
+ */
+
+#include "rwlock.h"
+#include "sys_call.h"
+#include "sys_calls.h"
+
+/**
+	\brief creates rwlock object.
+	\param max_readers: maximum count of readers, owning rwlock at same time
+	\retval rwlock HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE rwlock_create(unsigned int max_readers)
+{
+	return sys_call(RWLOCK_CREATE, max_readers, 0, 0);
+}
+
+/**
+	\brief try to lock rwlock for reading.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool rwlock_read_lock(HANDLE rwlock, TIME* timeout)
+{
+	return sys_call(RWLOCK_READ_LOCK, (unsigned int)rwlock, (unsigned int)timeout, 0);
+}
+
+/**
+	\brief try to lock rwlock for reading.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout_ms: time to try in milliseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool rwlock_read_lock_ms(HANDLE rwlock, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(RWLOCK_READ_LOCK, (unsigned int)rwlock, (unsigned int)&timeout, 0);
+}
+
+/**
+	\brief try to lock rwlock for reading.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout_us: time to try in microseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool rwlock_read_lock_us(HANDLE rwlock, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(RWLOCK_READ_LOCK, (unsigned int)rwlock, (unsigned int)&timeout, 0);
+}
+
+/**
+	\brief try to lock rwlock for writing.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout: pointer to TIME structure
+	\retval true on success, false on timeout
+*/
+bool rwlock_write_lock(HANDLE rwlock, TIME* timeout)
+{
+	return sys_call(RWLOCK_WRITE_LOCK, (unsigned int)rwlock, (unsigned int)timeout, 0);
+}
+
+/**
+	\brief try to lock rwlock for writing.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout_ms: time to try in milliseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool rwlock_write_lock_ms(HANDLE rwlock, unsigned int timeout_ms)
+{
+	TIME timeout;
+	ms_to_time(timeout_ms, &timeout);
+	return sys_call(RWLOCK_WRITE_LOCK, (unsigned int)rwlock, (unsigned int)&timeout, 0);
+}
+
+/**
+	\brief try to lock rwlock for writing.
+	\details If rwlock is already locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\param timeout_us: time to try in microseconds. Can be INFINITE
+	\retval true on success, false on timeout
+*/
+bool rwlock_write_lock_us(HANDLE rwlock, unsigned int timeout_us)
+{
+	TIME timeout;
+	us_to_time(timeout_us, &timeout);
+	return sys_call(RWLOCK_WRITE_LOCK, (unsigned int)rwlock, (unsigned int)&timeout, 0);
+}
+
+/**
+	\brief unlock rwlock, locked for reading or writing
+	\details If rwlock is not locked by current thread, exception is raised and current thread terminated
+	\param rwlock: rwlock handle
+	\retval none
+*/
+void rwlock_unlock(HANDLE rwlock)
+{
+	sys_call(RWLOCK_UNLOCK, (unsigned int)rwlock, 0, 0);
+}
+
+/**
+	\brief destroy rwlock
+	\param rwlock: rwlock handle
+	\retval none
+*/
+void rwlock_destroy(HANDLE rwlock)
+{
+	sys_call(RWLOCK_DESTROY, (unsigned int)rwlock, 0, 0);
+}
+
+/** \} */ // end of rwlock group
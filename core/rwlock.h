@@ -0,0 +1,43 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RWLOCK_H
+#define RWLOCK_H
+
+#include "types.h"
+#include "sys_time.h"
+
+HANDLE rwlock_create(unsigned int max_readers);
+bool rwlock_read_lock(HANDLE rwlock, TIME* timeout);
+bool rwlock_read_lock_ms(HANDLE rwlock, unsigned int timeout_ms);
+bool rwlock_read_lock_us(HANDLE rwlock, unsigned int timeout_us);
+bool rwlock_write_lock(HANDLE rwlock, TIME* timeout);
+bool rwlock_write_lock_ms(HANDLE rwlock, unsigned int timeout_ms);
+bool rwlock_write_lock_us(HANDLE rwlock, unsigned int timeout_us);
+void rwlock_unlock(HANDLE rwlock);
+void rwlock_destroy(HANDLE rwlock);
+
+#endif // RWLOCK_H
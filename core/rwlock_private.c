@@ -0,0 +1,242 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rwlock_private.h"
+#include "sys_calls.h"
+#include "mem.h"
+#include "mem_private.h"
+#include "error.h"
+#include "thread_private.h"
+#include "irq.h"
+
+const char *const RWLOCK_NAME =							"RWLOCK";
+
+//waiter sync_param mark
+#define RWLOCK_WAIT_WRITE										((void*)1)
+
+static inline RWLOCK* svc_rwlock_create(unsigned int max_readers)
+{
+	unsigned int i;
+	RWLOCK* rwlock = sys_alloc(sizeof(RWLOCK));
+	//at least one holder is required for writer
+	if (max_readers == 0)
+		max_readers = 1;
+	if (rwlock != NULL)
+	{
+		rwlock->holders = sys_alloc(max_readers * sizeof(RWLOCK_HOLDER));
+		if (rwlock->holders == NULL)
+		{
+			sys_free(rwlock);
+			rwlock = NULL;
+		}
+	}
+	if (rwlock != NULL)
+	{
+		rwlock->writer = NULL;
+		rwlock->readers_count = 0;
+		rwlock->holders_count = max_readers;
+		rwlock->waiters = NULL;
+		for (i = 0; i < max_readers; ++i)
+		{
+			rwlock->holders[i].owner = NULL;
+			rwlock->holders[i].owned.waiters = &rwlock->waiters;
+			rwlock->holders[i].owned.ceiling = MUTEX_NO_CEILING;
+		}
+		DO_MAGIC(rwlock, MAGIC_RWLOCK);
+	}
+	else
+		fatal_error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, RWLOCK_NAME);
+
+	return rwlock;
+}
+
+//thread == NULL will return free holder
+static RWLOCK_HOLDER* svc_rwlock_holder(RWLOCK* rwlock, THREAD* thread)
+{
+	unsigned int i;
+	for (i = 0; i < rwlock->holders_count; ++i)
+		if (rwlock->holders[i].owner == thread)
+			return &rwlock->holders[i];
+	return NULL;
+}
+
+static inline bool svc_rwlock_can_acquire(RWLOCK* rwlock, bool write)
+{
+	if (rwlock->writer)
+		return false;
+	if (write)
+		return rwlock->readers_count == 0;
+	return rwlock->readers_count < rwlock->holders_count;
+}
+
+static void svc_rwlock_acquire(RWLOCK* rwlock, THREAD* thread, bool write)
+{
+	RWLOCK_HOLDER* holder = svc_rwlock_holder(rwlock, NULL);
+	holder->owner = thread;
+	//holder is in owned list, so all rwlock waiters are raising priority of each reader
+	dlist_add_tail((DLIST**)&thread->owned_mutexes, (DLIST*)holder);
+	if (write)
+		rwlock->writer = thread;
+	else
+		++rwlock->readers_count;
+}
+
+void svc_rwlock_update_owners_priority(RWLOCK* rwlock)
+{
+	unsigned int i;
+	THREAD* owner;
+	for (i = 0; i < rwlock->holders_count; ++i)
+	{
+		owner = rwlock->holders[i].owner;
+		if (owner)
+			svc_thread_set_current_priority(owner, svc_mutex_calculate_owner_priority(owner));
+	}
+}
+
+//admit waiters from head in FIFO order. Reader behind waiting writer is not admitted, so writers are not starving
+static void svc_rwlock_grant(RWLOCK* rwlock)
+{
+	THREAD* thread;
+	bool write;
+	while ((thread = rwlock->waiters) != NULL)
+	{
+		write = thread->sync_param == RWLOCK_WAIT_WRITE;
+		if (!svc_rwlock_can_acquire(rwlock, write))
+			break;
+		dlist_remove_head((DLIST**)&rwlock->waiters);
+		svc_rwlock_acquire(rwlock, thread, write);
+		svc_thread_wakeup(thread);
+	}
+	//waiters list is changed, this can affect on owners priority
+	svc_rwlock_update_owners_priority(rwlock);
+}
+
+static inline bool svc_rwlock_lock(RWLOCK* rwlock, bool write, TIME* time)
+{
+	CHECK_MAGIC(rwlock, MAGIC_RWLOCK, RWLOCK_NAME);
+	THREAD* thread = svc_thread_get_current();
+	//recursive locking is not supported - reader can deadlock with waiting writer
+	if (svc_rwlock_holder(rwlock, thread))
+		error(ERROR_SYNC_ALREADY_OWNED, svc_thread_name(thread));
+	else if (rwlock->waiters == NULL && svc_rwlock_can_acquire(rwlock, write))
+		svc_rwlock_acquire(rwlock, thread, write);
+	else
+	{
+		//first - remove from active list
+		svc_thread_sleep(time, THREAD_SYNC_RWLOCK, rwlock);
+		thread->sync_param = write ? RWLOCK_WAIT_WRITE : NULL;
+		dlist_add_tail((DLIST**)&rwlock->waiters, (DLIST*)thread);
+		//raise priority of writer or all readers
+		svc_rwlock_update_owners_priority(rwlock);
+	}
+	//in case of timeout, we will patch result in context by thread_private.c
+	return true;
+}
+
+void svc_rwlock_lock_release(RWLOCK* rwlock, THREAD* thread)
+{
+	//can be called in irq context - on sys_timer timeout call from thread_private.c
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
+	CHECK_MAGIC(rwlock, MAGIC_RWLOCK, RWLOCK_NAME);
+	RWLOCK_HOLDER* holder = svc_rwlock_holder(rwlock, thread);
+	//release holder
+	if (holder)
+	{
+		dlist_remove((DLIST**)&thread->owned_mutexes, (DLIST*)holder);
+		holder->owner = NULL;
+		if (rwlock->writer == thread)
+			rwlock->writer = NULL;
+		else
+			--rwlock->readers_count;
+		svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
+	}
+	//remove item from waiters list
+	//it's up to caller to decide, wake up thread (timeout, rwlock destroy) or not (thread terminate) owned process
+	else
+		dlist_remove((DLIST**)&rwlock->waiters, (DLIST*)thread);
+	//both lock release and removing of waiting writer can admit next waiters
+	svc_rwlock_grant(rwlock);
+}
+
+static inline void svc_rwlock_unlock(RWLOCK* rwlock)
+{
+	CHECK_MAGIC(rwlock, MAGIC_RWLOCK, RWLOCK_NAME);
+	THREAD* thread = svc_thread_get_current();
+	if (rwlock->writer == NULL && rwlock->readers_count == 0)
+		error(ERROR_SYNC_ALREADY_UNLOCKED, svc_thread_name(thread));
+	else if (svc_rwlock_holder(rwlock, thread) == NULL)
+		error(ERROR_SYNC_WRONG_UNLOCKER, svc_thread_name(thread));
+	else
+		svc_rwlock_lock_release(rwlock, thread);
+}
+
+static inline void svc_rwlock_destroy(RWLOCK* rwlock)
+{
+	unsigned int i;
+	THREAD* thread;
+	while (rwlock->waiters)
+	{
+		thread = rwlock->waiters;
+		dlist_remove_head((DLIST**)&rwlock->waiters);
+		//patch return value
+		thread_patch_context(thread, false);
+		svc_thread_wakeup(thread);
+	}
+	for (i = 0; i < rwlock->holders_count; ++i)
+		if (rwlock->holders[i].owner)
+			svc_rwlock_lock_release(rwlock, rwlock->holders[i].owner);
+	sys_free(rwlock->holders);
+	sys_free(rwlock);
+}
+
+unsigned int svc_rwlock_handler(unsigned int num, unsigned int param1, unsigned int param2)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT);
+	CRITICAL_ENTER;
+	unsigned int res = 0;
+	switch (num)
+	{
+	case RWLOCK_CREATE:
+		res = (unsigned int)svc_rwlock_create(param1);
+		break;
+	case RWLOCK_READ_LOCK:
+		res = (unsigned int)svc_rwlock_lock((RWLOCK*)param1, false, (TIME*)param2);
+		break;
+	case RWLOCK_WRITE_LOCK:
+		res = (unsigned int)svc_rwlock_lock((RWLOCK*)param1, true, (TIME*)param2);
+		break;
+	case RWLOCK_UNLOCK:
+		svc_rwlock_unlock((RWLOCK*)param1);
+		break;
+	case RWLOCK_DESTROY:
+		svc_rwlock_destroy((RWLOCK*)param1);
+		break;
+	default:
+		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
+	}
+	CRITICAL_LEAVE;
+	return res;
+}
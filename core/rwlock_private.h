@@ -0,0 +1,58 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RWLOCK_PRIVATE_H
+#define RWLOCK_PRIVATE_H
+
+#include "mutex_private.h"
+
+typedef struct _RWLOCK RWLOCK;
+
+//one per lock holder - writer or each of readers
+typedef struct {
+	MUTEX_OWNED owned;
+	THREAD* owner;
+}RWLOCK_HOLDER;
+
+struct _RWLOCK {
+	MAGIC;
+	THREAD* writer;
+	unsigned int readers_count;
+	unsigned int holders_count;
+	RWLOCK_HOLDER* holders;
+	//list, FIFO. Writers are marked with sync_param
+	THREAD* waiters;
+};
+
+//raise priority of all holders according to waiters
+void svc_rwlock_update_owners_priority(RWLOCK* rwlock);
+//release lock, acquired by rwlock. Called from thread_private to release
+//locked object - by timeout or thread termination. also can be called on normal release
+void svc_rwlock_lock_release(RWLOCK* rwlock, THREAD* thread);
+
+unsigned int svc_rwlock_handler(unsigned int num, unsigned int param1, unsigned int param2);
+
+#endif // RWLOCK_PRIVATE_H
@@ -31,6 +31,10 @@
 	semaphore_wait*, decrements. If counter reached zero, thread will be putted
 	in waiting state until next semaphore_signal.
 
+	Counter can be limited by semaphore_create_max(), signals over limit are lost.
+	semaphore_signal_n() is counting many signals by single call - for example, from
+	ISR on DMA burst completion. semaphore_try_wait() never puts thread in waiting state.
+
 	Because semaphore_wait, semaphore_wait_ms, semaphore_wait_us can put current
 	thread in waiting state, this functions can be called only from
 	SYSTEM/USER context. Other functions, including semaphore_signal
@@ -51,6 +55,16 @@ HANDLE semaphore_create()
 	return sys_call(SEMAPHORE_CREATE, 0, 0, 0);
 }
 
+/**
+	\brief creates semaphore object with maximal counter value.
+	\param max: maximal counter value
+	\retval semaphore HANDLE on success. On failure (out of memory), error will be raised
+*/
+HANDLE semaphore_create_max(unsigned int max)
+{
+	return sys_call(SEMAPHORE_CREATE_MAX, max, 0, 0);
+}
+
 /**
 	\brief increments counter
 	\param sem: semaphore handle
@@ -61,6 +75,29 @@ void semaphore_signal(HANDLE sem)
 	sys_call(SEMAPHORE_SIGNAL, (unsigned int)sem, 0, 0);
 }
 
+/**
+	\brief increments counter by n
+	\details up to n waiters are released, rest is added to counter
+	\param sem: semaphore handle
+	\param n: count of signals
+	\retval none
+*/
+void semaphore_signal_n(HANDLE sem, unsigned int n)
+{
+	sys_call(SEMAPHORE_SIGNAL_N, (unsigned int)sem, n, 0);
+}
+
+/**
+	\brief decrement counter, if it's not zero
+	\details can be called from any context
+	\param sem: semaphore handle
+	\retval true on success, false if counter is zero
+*/
+bool semaphore_try_wait(HANDLE sem)
+{
+	return sys_call(SEMAPHORE_TRY_WAIT, (unsigned int)sem, 0, 0);
+}
+
 /**
 	\brief wait for semaphore signal
 	\param sem: semaphore handle
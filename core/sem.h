@@ -36,7 +36,10 @@
 #include "types.h"
 
 HANDLE semaphore_create();
+HANDLE semaphore_create_max(unsigned int max);
 void semaphore_signal(HANDLE sem);
+void semaphore_signal_n(HANDLE sem, unsigned int n);
+bool semaphore_try_wait(HANDLE sem);
 bool semaphore_wait(HANDLE sem, TIME* timeout);
 bool sempahore_wait_ms(HANDLE sem, unsigned int timeout_ms);
 bool semaphore_wait_us(HANDLE sem, unsigned int timeout_us);
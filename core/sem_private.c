@@ -34,12 +34,13 @@
 
 const char *const SEMAPHORE_NAME =							"SEMAPHORE";
 
-static inline SEMAPHORE* svc_semaphore_create()
+static inline SEMAPHORE* svc_semaphore_create(unsigned int max)
 {
 	SEMAPHORE* sem = sys_alloc(sizeof(SEMAPHORE));
 	if (sem != NULL)
 	{
 		sem->value = 0;
+		sem->max = max;
 		sem->waiters = NULL;
 		DO_MAGIC(sem, MAGIC_SEMAPHORE);
 	}
@@ -49,20 +50,34 @@ static inline SEMAPHORE* svc_semaphore_create()
 	return sem;
 }
 
-void svc_semaphore_signal(SEMAPHORE* sem)
+void svc_semaphore_signal_n(SEMAPHORE* sem, unsigned int n)
 {
 	CHECK_MAGIC(sem, MAGIC_SEMAPHORE, SEMAPHORE_NAME);
 
-	sem->value++;
-	//release all waiters
+	//if there are waiters, value is zero - release them directly
 	THREAD* thread;
-	while (sem->value && sem->waiters)
+	while (n && sem->waiters)
 	{
 		thread = sem->waiters;
 		dlist_remove_head((DLIST**)&sem->waiters);
 		svc_thread_wakeup(thread);
-		sem->value--;
+		--n;
 	}
+	//rest is counted, up to max value
+	if (n > sem->max - sem->value)
+		sem->value = sem->max;
+	else
+		sem->value += n;
+}
+
+static inline bool svc_semaphore_try_wait(SEMAPHORE* sem)
+{
+	CHECK_MAGIC(sem, MAGIC_SEMAPHORE, SEMAPHORE_NAME);
+
+	if (sem->value == 0)
+		return false;
+	--sem->value;
+	return true;
 }
 
 static inline bool svc_semaphore_wait(SEMAPHORE* sem, TIME* time)
@@ -70,7 +85,9 @@ static inline bool svc_semaphore_wait(SEMAPHORE* sem, TIME* time)
 	CHECK_MAGIC(sem, MAGIC_SEMAPHORE, SEMAPHORE_NAME);
 
 	THREAD* thread = svc_thread_get_current();
-	if (sem->value == 0)
+	if (sem->value)
+		--sem->value;
+	else
 	{
 		//first - remove from active list
 		//if called from IRQ context, thread_private.c will raise error
@@ -109,10 +126,10 @@ unsigned int svc_semaphore_handler(unsigned int num, unsigned int param1, unsign
 	switch (num)
 	{
 	case SEMAPHORE_CREATE:
-		res = (unsigned int)svc_semaphore_create();
+		res = (unsigned int)svc_semaphore_create(SEMAPHORE_NO_MAX);
 		break;
 	case SEMAPHORE_SIGNAL:
-		svc_semaphore_signal((SEMAPHORE*)param1);
+		svc_semaphore_signal_n((SEMAPHORE*)param1, 1);
 		break;
 	case SEMAPHORE_WAIT:
 		res = (unsigned int)svc_semaphore_wait((SEMAPHORE*)param1, (TIME*)param2);
@@ -120,6 +137,15 @@ unsigned int svc_semaphore_handler(unsigned int num, unsigned int param1, unsign
 	case SEMAPHORE_DESTROY:
 		svc_semaphore_destroy((SEMAPHORE*)param1);
 		break;
+	case SEMAPHORE_CREATE_MAX:
+		res = (unsigned int)svc_semaphore_create(param1);
+		break;
+	case SEMAPHORE_SIGNAL_N:
+		svc_semaphore_signal_n((SEMAPHORE*)param1, param2);
+		break;
+	case SEMAPHORE_TRY_WAIT:
+		res = (unsigned int)svc_semaphore_try_wait((SEMAPHORE*)param1);
+		break;
 	default:
 		error_value(ERROR_GENERAL_INVALID_SYS_CALL, num);
 	}
@@ -30,9 +30,12 @@
 #include "thread_private.h"
 #include "dbg.h"
 
+#define SEMAPHORE_NO_MAX									((unsigned int)-1)
+
 typedef struct {
 	MAGIC;
-	int value;
+	unsigned int value;
+	unsigned int max;
 	THREAD* waiters;
 }SEMAPHORE;
 
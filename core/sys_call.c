@@ -33,6 +33,11 @@
 
 #include "thread_private.h"
 #include "mutex_private.h"
+#include "rwlock_private.h"
+#include "cond_private.h"
+#include "ipc_private.h"
+#include "buf_private.h"
+#include "pubsub_private.h"
 #include "event_private.h"
 #include "sem_private.h"
 #include "queue_private.h"
@@ -75,6 +80,21 @@ unsigned int sys_handler(unsigned int num, unsigned int param1, unsigned int par
 	case SYS_CALL_SYS_TIMER:
 		res = (unsigned int)svc_sys_timer_handler(num, param1);
 		break;
+	case SYS_CALL_RWLOCK:
+		res = (unsigned int)svc_rwlock_handler(num, param1, param2);
+		break;
+	case SYS_CALL_COND:
+		res = (unsigned int)svc_cond_handler(num, param1, param2, param3);
+		break;
+	case SYS_CALL_IPC:
+		res = (unsigned int)svc_ipc_handler(num, param1, param2, param3);
+		break;
+	case SYS_CALL_BUF:
+		res = (unsigned int)svc_buf_handler(num, param1, param2, param3);
+		break;
+	case SYS_CALL_PUBSUB:
+		res = (unsigned int)svc_pubsub_handler(num, param1, param2, param3);
+		break;
 	case SYS_CALL_TIME:
 		res = (unsigned int)svc_sys_time_handler(num, param1);
 		break;
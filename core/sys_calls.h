@@ -51,6 +51,11 @@ typedef enum {
 	SYS_CALL_SEMAPHORE= 0x3 * CALL_GROUP,
 	SYS_CALL_QUEUE		= 0x4 * CALL_GROUP,
 	SYS_CALL_SYS_TIMER= 0x5 * CALL_GROUP,
+	SYS_CALL_RWLOCK	= 0x6 * CALL_GROUP,
+	SYS_CALL_COND		= 0x7 * CALL_GROUP,
+	SYS_CALL_IPC		= 0x8 * CALL_GROUP,
+	SYS_CALL_BUF		= 0x9 * CALL_GROUP,
+	SYS_CALL_PUBSUB	= 0xa * CALL_GROUP,
 	//system context
 	SYS_CALL_TIME		= CALL_CONTEXT + 0x0 * CALL_GROUP,
 	SYS_CALL_MEM		= CALL_CONTEXT + 0x1 * CALL_GROUP,
@@ -64,7 +69,9 @@ typedef enum {
 	THREAD_GET_CURRENT,
 	THREAD_SET_PRIORITY,
 	THREAD_DESTROY,
-	THREAD_SLEEP
+	THREAD_SLEEP,
+	THREAD_SLEEP_UNTIL,
+	THREAD_SET_PREEMPTION_THRESHOLD
 #if (KERNEL_PROFILING)
 					,
 	THREAD_SWITCH_TEST,
@@ -77,9 +84,53 @@ typedef enum {
 	MUTEX_CREATE = SYS_CALL_MUTEX,
 	MUTEX_LOCK,
 	MUTEX_UNLOCK,
-	MUTEX_DESTROY
+	MUTEX_DESTROY,
+	MUTEX_CREATE_CEILING
 }MUTEX_SYS_CALLS;
 
+typedef enum {
+	RWLOCK_CREATE = SYS_CALL_RWLOCK,
+	RWLOCK_READ_LOCK,
+	RWLOCK_WRITE_LOCK,
+	RWLOCK_UNLOCK,
+	RWLOCK_DESTROY
+}RWLOCK_SYS_CALLS;
+
+typedef enum {
+	COND_CREATE = SYS_CALL_COND,
+	COND_WAIT,
+	COND_SIGNAL,
+	COND_BROADCAST,
+	COND_DESTROY
+}COND_SYS_CALLS;
+
+typedef enum {
+	IPC_CREATE = SYS_CALL_IPC,
+	IPC_CALL,
+	IPC_RECEIVE,
+	IPC_REPLY,
+	IPC_REPLY_RECEIVE,
+	IPC_DESTROY
+}IPC_SYS_CALLS;
+
+typedef enum {
+	BUF_POOL_CREATE = SYS_CALL_BUF,
+	BUF_ALLOC,
+	BUF_REF,
+	BUF_FREE,
+	BUF_POOL_DESTROY
+}BUF_SYS_CALLS;
+
+typedef enum {
+	TOPIC_CREATE = SYS_CALL_PUBSUB,
+	TOPIC_PUBLISH,
+	TOPIC_DESTROY,
+	TOPIC_SUBSCRIBE,
+	TOPIC_READ,
+	TOPIC_GET_DROPPED,
+	TOPIC_UNSUBSCRIBE
+}PUBSUB_SYS_CALLS;
+
 typedef enum {
 	EVENT_CREATE = SYS_CALL_EVENT,
 	EVENT_PULSE,
@@ -87,14 +138,18 @@ typedef enum {
 	EVENT_IS_SET,
 	EVENT_CLEAR,
 	EVENT_WAIT,
-	EVENT_DESTROY
+	EVENT_DESTROY,
+	EVENT_CREATE_AUTO_RESET
 }EVENT_SYS_CALLS;
 
 typedef enum {
 	SEMAPHORE_CREATE = SYS_CALL_SEMAPHORE,
 	SEMAPHORE_WAIT,
 	SEMAPHORE_SIGNAL,
-	SEMAPHORE_DESTROY
+	SEMAPHORE_DESTROY,
+	SEMAPHORE_CREATE_MAX,
+	SEMAPHORE_SIGNAL_N,
+	SEMAPHORE_TRY_WAIT
 }SEMAPHORE_SYS_CALLS;
 
 typedef enum {
@@ -105,7 +160,14 @@ typedef enum {
 	QUEUE_RELEASE_BUFFER,
 	QUEUE_IS_EMPTY,
 	QUEUE_IS_FULL,
-	QUEUE_DESTROY
+	QUEUE_DESTROY,
+	QUEUE_CREATE_RING,
+	QUEUE_POST,
+	QUEUE_PEEK,
+	QUEUE_ALLOCATE_BUFFERS,
+	QUEUE_PUSH_BUFFERS,
+	QUEUE_PULL_BUFFERS,
+	QUEUE_RELEASE_BUFFERS
 }QUEUE_SYS_CALLS;
 
 typedef enum {
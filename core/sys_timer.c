@@ -127,10 +127,16 @@ void svc_sys_timer_create(TIMER* timer)
 {
 	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
 	TIME uptime;
+	//adjust time, according current uptime
 	svc_get_uptime(&uptime);
 	time_add(&uptime, &timer->time, &timer->time);
+	svc_sys_timer_create_absolute(timer);
+}
+
+void svc_sys_timer_create_absolute(TIMER* timer)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
 	CRITICAL_ENTER;
-	//adjust time, according current uptime
 	int list_size = _timers_count;
 	if (list_size > SYS_TIMER_CACHE_SIZE)
 		list_size = SYS_TIMER_CACHE_SIZE;
@@ -205,30 +211,38 @@ void svc_sys_timer_destroy(TIMER* timer)
 	int first = 0;
 	int last = list_size - 1;
 	int mid;
-	while (first < last)
+	bool found = false;
+	if (list_size)
 	{
-		mid = (first + last) >> 1;
-		if (time_compare(&_timers[mid]->time, &timer->time) > 0)
-			first = mid + 1;
-		else
-			last = mid;
+		while (first < last)
+		{
+			mid = (first + last) >> 1;
+			if (time_compare(&_timers[mid]->time, &timer->time) > 0)
+				first = mid + 1;
+			else
+				last = mid;
+		}
+		pos = first;
+		if (time_compare(&_timers[pos]->time, &timer->time) > 0)
+			++pos;
+		//timers with same time are not ordered
+		while (pos < list_size && _timers[pos] != timer && time_compare(&_timers[pos]->time, &timer->time) == 0)
+			++pos;
 	}
-	pos = first;
-	if (time_compare(&_timers[pos]->time, &timer->time) > 0)
-		++pos;
 
 	//timer in cache?
-	if (pos < SYS_TIMER_CACHE_SIZE)
+	if (pos < list_size && _timers[pos] == timer)
 	{
 		memmove(_timers + pos, _timers + pos + 1, (list_size - pos - 1) * sizeof(void*));
-		if (_timers_count >= SYS_TIMER_CACHE_SIZE)
+		if (_timers_count > SYS_TIMER_CACHE_SIZE)
 		{
 			_timers[SYS_TIMER_CACHE_SIZE - 1] = _timers_uncached;
 			dlist_remove_head((DLIST**)&_timers_uncached);
 		}
+		found = true;
 	}
 	//timer in uncached area
-	else
+	else if (_timers_count > SYS_TIMER_CACHE_SIZE)
 	{
 		DLIST_ENUM de;
 		TIMER* cur;
@@ -236,11 +250,14 @@ void svc_sys_timer_destroy(TIMER* timer)
 		while (dlist_enum(&de, (DLIST**)&cur))
 			if (cur == timer)
 			{
-				dlist_remove((DLIST**)&_timers_uncached, (DLIST*)&cur);
+				dlist_remove((DLIST**)&_timers_uncached, (DLIST*)cur);
+				found = true;
 				break;
 			}
 	}
-	--_timers_count;
+	//timer is already fired (or never created) - nothing to remove
+	if (found)
+		--_timers_count;
 	CRITICAL_LEAVE;
 }
 
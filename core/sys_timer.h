@@ -44,6 +44,9 @@ void sys_timer_init();
 
 //can be called from SVC/IRQ
 void svc_sys_timer_create(TIMER* timer);
+//timer->time is absolute uptime, not offset from now
+void svc_sys_timer_create_absolute(TIMER* timer);
+//ignored, if timer is already fired and removed from queue
 void svc_sys_timer_destroy(TIMER* timer);
 TIME* svc_get_uptime(TIME* uptime);
 unsigned int svc_sys_timer_handler(unsigned int num, unsigned int param1);
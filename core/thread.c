@@ -132,6 +132,20 @@ void thread_set_current_priority(unsigned int priority)
 	thread_set_priority(thread_get_current(), priority);
 }
 
+/**
+	\brief set preemption threshold
+	\details While running, thread can be preempted only by threads with priority, higher than threshold.
+	Group of threads, sharing data can use same threshold, so they are not preempting each other, while
+	higher priority threads are still served. Threshold doesn't affect on waiting threads.
+	\param thread: handle of created thread
+	\param threshold: preemption threshold. 0 - highest, -1 - disabled (default)
+	\retval none
+*/
+void thread_set_preemption_threshold(HANDLE thread, unsigned int threshold)
+{
+	sys_call(THREAD_SET_PREEMPTION_THRESHOLD, (unsigned int)thread, threshold, 0);
+}
+
 /**
 	\brief destroys thread
 	\param thread: previously created thread
@@ -186,6 +200,100 @@ void sleep_us(unsigned int us)
 	sys_call(THREAD_SLEEP, (unsigned int)&time, 0, 0);
 }
 
+/**
+	\brief put current thread in waiting state until absolute uptime is reached
+	\details unlike \ref sleep, wakeup time doesn't depend on time, spent by caller
+	before the call. If time is already in the past, function returns immediatly
+	\param time: pointer to TIME structure, containing absolute uptime
+	\retval none
+*/
+void sleep_until(TIME* time)
+{
+	sys_call(THREAD_SLEEP_UNTIL, (unsigned int)time, 0, 0);
+}
+
+/**
+	\brief start periodic release cursor
+	\details first release will be after one period from now.
+	Cursor is advanced by exactly one period on every \ref periodic_wait call,
+	so thread execution and preemption time doesn't stretch the period
+	\param periodic: pointer to allocated \ref PERIODIC structure
+	\param period: pointer to TIME structure, containing period. Must be greater 0
+	\retval none
+*/
+void periodic_start(PERIODIC* periodic, TIME* period)
+{
+	periodic->period.sec = period->sec;
+	periodic->period.usec = period->usec;
+	periodic->overruns = 0;
+#if (KERNEL_PROFILING)
+	periodic->jitter_max_us = 0;
+#endif //KERNEL_PROFILING
+	get_uptime(&periodic->next);
+	time_add(&periodic->next, &periodic->period, &periodic->next);
+}
+
+/**
+	\brief start periodic release cursor. See \ref periodic_start for details
+	\param periodic: pointer to allocated \ref PERIODIC structure
+	\param period_ms: period in milliseconds
+	\retval none
+*/
+void periodic_start_ms(PERIODIC* periodic, unsigned int period_ms)
+{
+	TIME period;
+	ms_to_time(period_ms, &period);
+	periodic_start(periodic, &period);
+}
+
+/**
+	\brief start periodic release cursor. See \ref periodic_start for details
+	\param periodic: pointer to allocated \ref PERIODIC structure
+	\param period_us: period in microseconds
+	\retval none
+*/
+void periodic_start_us(PERIODIC* periodic, unsigned int period_us)
+{
+	TIME period;
+	us_to_time(period_us, &period);
+	periodic_start(periodic, &period);
+}
+
+/**
+	\brief wait for next periodic release
+	\details If release time is already missed, function returns immediatly. Missed
+	releases are skipped, keeping original phase. Count of overruns is saved in periodic->overruns.
+	If \ref KERNEL_PROFILING is set, maximal wakeup latency is saved in periodic->jitter_max_us
+	\param periodic: pointer to started \ref PERIODIC structure
+	\retval true if released on time, false on overrun
+*/
+bool periodic_wait(PERIODIC* periodic)
+{
+	TIME uptime;
+	bool res = true;
+	get_uptime(&uptime);
+	if (time_compare(&uptime, &periodic->next) > 0)
+	{
+		sys_call(THREAD_SLEEP_UNTIL, (unsigned int)&periodic->next, 0, 0);
+#if (KERNEL_PROFILING)
+		unsigned int jitter = time_elapsed_us(&periodic->next);
+		if (jitter > periodic->jitter_max_us)
+			periodic->jitter_max_us = jitter;
+#endif //KERNEL_PROFILING
+		time_add(&periodic->next, &periodic->period, &periodic->next);
+	}
+	//overrun. Skip all missed releases
+	else
+	{
+		res = false;
+		++periodic->overruns;
+		do {
+			time_add(&periodic->next, &periodic->period, &periodic->next);
+		} while (time_compare(&uptime, &periodic->next) <= 0);
+	}
+	return res;
+}
+
 /** \} */ // end of thread group
 
 #if (KERNEL_PROFILING)
@@ -41,6 +41,15 @@ typedef struct {
 	void* param;
 }THREAD_CALL;
 
+typedef struct {
+	TIME next;
+	TIME period;
+	unsigned int overruns;
+#if (KERNEL_PROFILING)
+	unsigned int jitter_max_us;
+#endif //KERNEL_PROFILING
+}PERIODIC;
+
 HANDLE thread_create(const char* name, int stack_size, unsigned int priority, THREAD_FUNCTION fn, void* param);
 HANDLE thread_create_and_run(const char* name, int stack_size, unsigned int priority, THREAD_FUNCTION fn, void* param);
 void thread_unfreeze(HANDLE thread);
@@ -48,11 +57,18 @@ void thread_freeze(HANDLE thread);
 HANDLE thread_get_current();
 void thread_set_priority(HANDLE thread, unsigned int priority);
 void thread_set_current_priority(unsigned int priority);
+void thread_set_preemption_threshold(HANDLE thread, unsigned int threshold);
 void thread_destroy(HANDLE thread);
 void thread_exit();
 void sleep(TIME* time);
 void sleep_ms(unsigned int ms);
 void sleep_us(unsigned int us);
+void sleep_until(TIME* time);
+
+void periodic_start(PERIODIC* periodic, TIME* period);
+void periodic_start_ms(PERIODIC* periodic, unsigned int period_ms);
+void periodic_start_us(PERIODIC* periodic, unsigned int period_us);
+bool periodic_wait(PERIODIC* periodic);
 
 #if (KERNEL_PROFILING)
 //this function freeze current thread, then unfrize it again and simulate context switch. main use - test switch context perfomance
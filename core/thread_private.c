@@ -34,6 +34,10 @@
 #include <stddef.h>
 #include "string.h"
 #include "mutex_private.h"
+#include "rwlock_private.h"
+#include "cond_private.h"
+#include "ipc_private.h"
+#include "pubsub_private.h"
 #include "event_private.h"
 #include "sem_private.h"
 #include "queue_private.h"
@@ -53,6 +57,8 @@
 #define THREAD_MODE_WAITING_SYNC_OBJECT																			(1 << 1)
 
 #define THREAD_TIMER_ACTIVE																							(1 << 2)
+//preempted while running with threshold. Queued by threshold, ahead of threads at same level
+#define THREAD_PREEMPTED																								(1 << 3)
 
 #define THREAD_SYNC_MASK																								(0xf << 4)
 
@@ -69,6 +75,7 @@ extern void svc_stack_stat();
 #define IDLE_PRIORITY																									((unsigned int)-1)
 
 #define THREAD_NAME(thread)																							thread->name ? thread->name : UNNAMED_THREAD
+#define THREAD_THRESHOLD(thread)																						((thread)->preemption_threshold < (thread)->current_priority ? (thread)->preemption_threshold : (thread)->current_priority)
 
 static THREAD* _active_threads[THREAD_CACHE_SIZE] __attribute__ ((section (".sys_bss"))) =		{NULL};
 static THREAD* _threads_uncached __attribute__ ((section (".sys_bss"))) =								NULL;
@@ -77,6 +84,10 @@ static int _thread_list_size __attribute__ ((section (".sys_bss"))) =									0;
 //Current thread. If there is no active tasks, idle_task will be run
 static THREAD* _current_thread __attribute__ ((section (".sys_bss"))) =									NULL;
 static THREAD* _idle_thread __attribute__ ((section (".sys_bss"))) =										NULL;
+#if (KERNEL_PROFILING)
+//context switches, saved by preemption threshold
+static unsigned int _preemptions_saved __attribute__ ((section (".sys_bss"))) =							0;
+#endif //KERNEL_PROFILING
 
 //for context-switching
 //now running thread. (Active context)
@@ -112,8 +123,26 @@ void svc_thread_timeout(void* param)
 		svc_semaphore_lock_release((SEMAPHORE*)thread->sync_object, thread);
 		break;
 	case THREAD_SYNC_QUEUE:
+	case THREAD_SYNC_QUEUE_BATCH:
 		svc_queue_lock_release((QUEUE*)thread->sync_object, thread);
 		break;
+	case THREAD_SYNC_RWLOCK:
+		svc_rwlock_lock_release((RWLOCK*)thread->sync_object, thread);
+		break;
+	case THREAD_SYNC_COND:
+		//thread is waked up only after mutex reacquire
+		svc_cond_timeout((COND*)thread->sync_object, thread);
+		CRITICAL_LEAVE;
+		return;
+	case THREAD_SYNC_IPC:
+		svc_ipc_lock_release((IPC_ENDPOINT*)thread->sync_object, thread);
+		break;
+	case THREAD_SYNC_TOPIC:
+		svc_topic_lock_release((TOPIC*)thread->sync_object, thread);
+		break;
+	case THREAD_SYNC_SUBSCRIBER:
+		svc_subscriber_lock_release((SUBSCRIBER*)thread->sync_object, thread);
+		break;
 	default:
 		ASSERT(false);
 	}
@@ -138,6 +167,8 @@ THREAD* svc_thread_create(THREAD_CALL* tc)
 		thread->flags = 0;
 		thread->base_priority = tc->priority;
 		thread->current_priority = thread->base_priority;
+		thread->preemption_threshold = IDLE_PRIORITY;
+		thread->active_priority = thread->current_priority;
 		//allocate thread stack
 		thread->sp_top = stack_alloc(tc->stack_size * sizeof(int));
 		thread->sp_cur = thread->sp_top + tc->stack_size;
@@ -157,6 +188,7 @@ THREAD* svc_thread_create(THREAD_CALL* tc)
 			thread->timer.param = thread;
 			thread->owned_mutexes = NULL;
 			thread->sync_object = NULL;
+			thread->sync_param = NULL;
 			thread->pool = NULL;
 
 			DO_MAGIC(thread, MAGIC_THREAD);
@@ -195,9 +227,9 @@ static inline void pop_last_from_list()
 	if (_threads_uncached != NULL)
 	{
 		_active_threads[THREAD_CACHE_SIZE - 1] = NULL;
-		int priority = _threads_uncached->current_priority;
+		int priority = _threads_uncached->active_priority;
 		THREAD* cur;
-		while (_threads_uncached != NULL && _threads_uncached->current_priority == priority)
+		while (_threads_uncached != NULL && _threads_uncached->active_priority == priority)
 		{
 			cur = _threads_uncached;
 			dlist_remove_head((DLIST**)&_threads_uncached);
@@ -213,8 +245,9 @@ static inline void pop_last_from_list()
 void thread_add_to_active_list(THREAD* thread)
 {
 	THREAD* thread_to_save = thread;
-	//thread priority is less, than active, activate him
-	if (thread->current_priority < _current_thread->current_priority)
+	thread->active_priority = (thread->flags & THREAD_PREEMPTED) ? THREAD_THRESHOLD(thread) : thread->current_priority;
+	//thread priority is less, than active and active preemption threshold, activate him
+	if (thread->active_priority < THREAD_THRESHOLD(_current_thread))
 	{
 #if (KERNEL_PROFILING)
 		svc_get_uptime(&thread->uptime_start);
@@ -222,10 +255,22 @@ void thread_add_to_active_list(THREAD* thread)
 		time_add(&_current_thread->uptime_start, &_current_thread->uptime, &_current_thread->uptime);
 #endif //KERNEL_PROFILING
 
+		thread->flags &= ~THREAD_PREEMPTED;
 		thread_to_save = _current_thread;
 		_current_thread = thread;
 		_next_thread = thread;
+		//preempted thread must be resumed before any thread, that couldn't preempt him
+		if (thread_to_save->preemption_threshold < thread_to_save->current_priority)
+			thread_to_save->flags |= THREAD_PREEMPTED;
+		thread_to_save->active_priority = (thread_to_save->flags & THREAD_PREEMPTED) ? THREAD_THRESHOLD(thread_to_save) : thread_to_save->current_priority;
 	}
+#if (KERNEL_PROFILING)
+	else if (thread->current_priority < _current_thread->current_priority)
+		++_preemptions_saved;
+#endif //KERNEL_PROFILING
+	unsigned int priority = thread_to_save->active_priority;
+	//preempted thread is queued first on his level, other - last
+	bool first_on_level = (thread_to_save->flags & THREAD_PREEMPTED) != 0;
 	//first - look at cache
 	int pos = 0;
 	if (_thread_list_size)
@@ -236,13 +281,13 @@ void thread_add_to_active_list(THREAD* thread)
 		while (first < last)
 		{
 			mid = (first + last) >> 1;
-			if (_active_threads[mid]->current_priority < thread_to_save->current_priority)
+			if (_active_threads[mid]->active_priority < priority)
 				first = mid + 1;
 			else
 				last = mid;
 		}
 		pos = first;
-		if (_active_threads[pos]->current_priority < thread_to_save->current_priority)
+		if (_active_threads[pos]->active_priority < priority)
 			++pos;
 	}
 
@@ -250,23 +295,26 @@ void thread_add_to_active_list(THREAD* thread)
 	if (pos < THREAD_CACHE_SIZE)
 	{
 		//does we have active thread with same priority?
-		if (!(_active_threads[pos] != NULL && _active_threads[pos]->current_priority == thread_to_save->current_priority))
+		if (!(_active_threads[pos] != NULL && _active_threads[pos]->active_priority == priority))
 		{
 			//last list is going out ouf cache
 			push_last_in_list();
 			memmove(_active_threads + pos + 1, _active_threads + pos, (_thread_list_size - pos - 1) * sizeof(void*));
 			_active_threads[pos] = NULL;
 		}
-		dlist_add_tail((DLIST**)&_active_threads[pos], (DLIST*)thread_to_save);
+		if (first_on_level)
+			dlist_add_head((DLIST**)&_active_threads[pos], (DLIST*)thread_to_save);
+		else
+			dlist_add_tail((DLIST**)&_active_threads[pos], (DLIST*)thread_to_save);
 	}
 	//find and allocate timer on uncached list
 	else
 	{
 		//top
-		if (_threads_uncached == NULL || thread_to_save->current_priority < _threads_uncached->current_priority)
+		if (_threads_uncached == NULL || priority < _threads_uncached->active_priority || (first_on_level && priority == _threads_uncached->active_priority))
 			dlist_add_head((DLIST**)&_threads_uncached, (DLIST*)thread_to_save);
 		//bottom
-		else if (thread_to_save->current_priority >= ((THREAD*)_threads_uncached->list.prev)->current_priority)
+		else if (priority > ((THREAD*)_threads_uncached->list.prev)->active_priority || (!first_on_level && priority == ((THREAD*)_threads_uncached->list.prev)->active_priority))
 			dlist_add_tail((DLIST**)&_threads_uncached, (DLIST*)thread_to_save);
 		//in the middle
 		else
@@ -275,7 +323,7 @@ void thread_add_to_active_list(THREAD* thread)
 			THREAD* cur;
 			dlist_enum_start((DLIST**)&_threads_uncached, &de);
 			while (dlist_enum(&de, (DLIST**)&cur))
-				if (cur->current_priority < thread_to_save->current_priority)
+				if (priority < cur->active_priority || (first_on_level && priority == cur->active_priority))
 				{
 					dlist_add_before((DLIST**)&_threads_uncached, (DLIST*)cur, (DLIST*)thread_to_save);
 					break;
@@ -287,6 +335,7 @@ void thread_add_to_active_list(THREAD* thread)
 void thread_remove_from_active_list(THREAD* thread)
 {
 	int pos = 0;
+	THREAD* to_remove = thread;
 	//freeze active task
 	if (thread == _current_thread)
 	{
@@ -297,6 +346,9 @@ void thread_remove_from_active_list(THREAD* thread)
 #endif //KERNEL_PROFILING
 		_current_thread = _active_threads[0];
 		_next_thread = _active_threads[0];
+		_current_thread->flags &= ~THREAD_PREEMPTED;
+		//current thread is not in active list, next one is taken from head
+		to_remove = _current_thread;
 	}
 	//try to search in cache
 	else
@@ -307,19 +359,19 @@ void thread_remove_from_active_list(THREAD* thread)
 		while (first < last)
 		{
 			mid = (first + last) >> 1;
-			if (_active_threads[mid]->current_priority < thread->current_priority)
+			if (_active_threads[mid]->active_priority < thread->active_priority)
 				first = mid + 1;
 			else
 				last = mid;
 		}
 		pos = first;
-		if (_active_threads[pos]->current_priority < thread->current_priority)
+		if (_active_threads[pos]->active_priority < thread->active_priority)
 			++pos;
 	}
 
 	if (pos < THREAD_CACHE_SIZE)
 	{
-		dlist_remove_head((DLIST**)&(_active_threads[pos]));
+		dlist_remove((DLIST**)&(_active_threads[pos]), (DLIST*)to_remove);
 
 		//removed all at current priority level
 		if (_active_threads[pos] == NULL)
@@ -377,6 +429,37 @@ THREAD* svc_thread_get_current()
 	return _current_thread;
 }
 
+THREAD_SYNC_TYPE svc_thread_sync_type(THREAD* thread)
+{
+	return thread->flags & THREAD_SYNC_MASK;
+}
+
+void svc_thread_change_sync_object(THREAD* thread, THREAD_SYNC_TYPE sync_type, void* sync_object)
+{
+	if (thread->flags & THREAD_TIMER_ACTIVE)
+	{
+		svc_sys_timer_destroy(&thread->timer);
+		thread->flags &= ~THREAD_TIMER_ACTIVE;
+	}
+	thread->flags &= ~THREAD_SYNC_MASK;
+	thread->flags |= sync_type;
+	thread->sync_object = sync_object;
+}
+
+//ready thread can preempt current after his priority or threshold is lowered
+static inline void thread_preempt_current()
+{
+	THREAD* thread = _current_thread;
+	if (_active_threads[0] != NULL && _active_threads[0]->active_priority < THREAD_THRESHOLD(thread))
+	{
+		thread_remove_from_active_list(thread);
+		if (thread->preemption_threshold < thread->current_priority)
+			thread->flags |= THREAD_PREEMPTED;
+		thread_add_to_active_list(thread);
+		pend_switch_context();
+	}
+}
+
 void svc_thread_set_current_priority(THREAD* thread, unsigned int priority)
 {
 	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
@@ -386,11 +469,20 @@ void svc_thread_set_current_priority(THREAD* thread, unsigned int priority)
 		switch (thread->flags & THREAD_MODE_MASK)
 		{
 		case THREAD_MODE_RUNNING:
-			thread_remove_from_active_list(thread);
-			thread->current_priority = priority;
-			thread_add_to_active_list(thread);
-			if (_next_thread)
-				pend_switch_context();
+			//current thread is not in active list
+			if (thread == _current_thread)
+			{
+				thread->current_priority = priority;
+				thread_preempt_current();
+			}
+			else
+			{
+				thread_remove_from_active_list(thread);
+				thread->current_priority = priority;
+				thread_add_to_active_list(thread);
+				if (_next_thread)
+					pend_switch_context();
+			}
 			break;
 		//if we are waiting for mutex, adjusting priority can affect on mutex owner
 		case THREAD_MODE_WAITING:
@@ -398,6 +490,8 @@ void svc_thread_set_current_priority(THREAD* thread, unsigned int priority)
 			thread->current_priority = priority;
 			if ((thread->flags & THREAD_SYNC_MASK) == THREAD_SYNC_MUTEX)
 				svc_thread_set_current_priority(((MUTEX*)thread->sync_object)->owner, svc_mutex_calculate_owner_priority(((MUTEX*)thread->sync_object)->owner));
+			else if ((thread->flags & THREAD_SYNC_MASK) == THREAD_SYNC_RWLOCK)
+				svc_rwlock_update_owners_priority((RWLOCK*)thread->sync_object);
 			break;
 		default:
 			thread->current_priority = priority;
@@ -416,6 +510,15 @@ static inline void svc_thread_set_priority(THREAD* thread, unsigned int priority
 	svc_thread_set_current_priority(thread, svc_mutex_calculate_owner_priority(thread));
 }
 
+static inline void svc_thread_set_preemption_threshold(THREAD* thread, unsigned int threshold)
+{
+	CHECK_MAGIC(thread, MAGIC_THREAD, THREAD_NAME(thread));
+	thread->preemption_threshold = threshold;
+	//threshold is lowered, ready thread, held by threshold can preempt us now
+	if (thread == _current_thread)
+		thread_preempt_current();
+}
+
 static void svc_thread_destroy(THREAD* thread)
 {
 	CHECK_MAGIC(thread, MAGIC_THREAD, THREAD_NAME(thread));
@@ -453,8 +556,24 @@ static void svc_thread_destroy(THREAD* thread)
 			svc_semaphore_lock_release((SEMAPHORE*)thread->sync_object, thread);
 			break;
 		case THREAD_SYNC_QUEUE:
+		case THREAD_SYNC_QUEUE_BATCH:
 			svc_queue_lock_release((QUEUE*)thread->sync_object, thread);
 			break;
+		case THREAD_SYNC_RWLOCK:
+			svc_rwlock_lock_release((RWLOCK*)thread->sync_object, thread);
+			break;
+		case THREAD_SYNC_COND:
+			svc_cond_lock_release((COND*)thread->sync_object, thread);
+			break;
+		case THREAD_SYNC_IPC:
+			svc_ipc_lock_release((IPC_ENDPOINT*)thread->sync_object, thread);
+			break;
+		case THREAD_SYNC_TOPIC:
+			svc_topic_lock_release((TOPIC*)thread->sync_object, thread);
+			break;
+		case THREAD_SYNC_SUBSCRIBER:
+			svc_subscriber_lock_release((SUBSCRIBER*)thread->sync_object, thread);
+			break;
 		default:
 			ASSERT(false);
 		}
@@ -469,7 +588,7 @@ void svc_thread_destroy_current()
 	svc_thread_destroy(_current_thread);
 }
 
-void svc_thread_sleep(TIME* time, THREAD_SYNC_TYPE sync_type, void *sync_object)
+static inline THREAD* svc_thread_wait(THREAD_SYNC_TYPE sync_type, void *sync_object)
 {
 	CHECK_CONTEXT(SUPERVISOR_CONTEXT);
 	THREAD* thread = _current_thread;
@@ -482,11 +601,11 @@ void svc_thread_sleep(TIME* time, THREAD_SYNC_TYPE sync_type, void *sync_object)
 	thread->flags &= ~(THREAD_MODE_MASK | THREAD_SYNC_MASK);
 	thread->flags |= THREAD_MODE_WAITING | sync_type;
 	thread->sync_object = sync_object;
+	return thread;
+}
 
-	//adjust owner priority
-	if (sync_type == THREAD_SYNC_MUTEX && ((MUTEX*)sync_object)->owner->current_priority > thread->current_priority)
-		svc_thread_set_current_priority(((MUTEX*)sync_object)->owner, thread->current_priority);
-
+static inline void svc_thread_timer_start(THREAD* thread, TIME* time)
+{
 	//create timer if not infinite
 	if (time->sec || time->usec)
 	{
@@ -497,6 +616,32 @@ void svc_thread_sleep(TIME* time, THREAD_SYNC_TYPE sync_type, void *sync_object)
 	}
 }
 
+void svc_thread_sleep(TIME* time, THREAD_SYNC_TYPE sync_type, void *sync_object)
+{
+	THREAD* thread = svc_thread_wait(sync_type, sync_object);
+
+	//adjust owner priority
+	if (sync_type == THREAD_SYNC_MUTEX && ((MUTEX*)sync_object)->owner->current_priority > thread->current_priority)
+		svc_thread_set_current_priority(((MUTEX*)sync_object)->owner, thread->current_priority);
+
+	svc_thread_timer_start(thread, time);
+}
+
+static inline void svc_thread_sleep_until(TIME* time)
+{
+	TIME uptime;
+	svc_get_uptime(&uptime);
+	//deadline is already in the past, don't wait at all
+	if (time_compare(&uptime, time) <= 0)
+		return;
+	THREAD* thread = svc_thread_wait(THREAD_SYNC_TIMER_ONLY, NULL);
+	//absolute timer: release time doesn't depend on how late we are called
+	thread->flags |= THREAD_TIMER_ACTIVE;
+	thread->timer.time.sec = time->sec;
+	thread->timer.time.usec = time->usec;
+	svc_sys_timer_create_absolute(&thread->timer);
+}
+
 void svc_thread_wakeup(THREAD* thread)
 {
 	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT);
@@ -526,6 +671,42 @@ void svc_thread_wakeup(THREAD* thread)
 	}
 }
 
+bool svc_thread_handoff(THREAD* thread, TIME* time, THREAD_SYNC_TYPE sync_type, void* sync_object)
+{
+	CHECK_CONTEXT(SUPERVISOR_CONTEXT);
+	CHECK_MAGIC(thread, MAGIC_THREAD, THREAD_NAME(thread));
+	THREAD* current = _current_thread;
+	//frozen thread can't run, idle thread can't wait
+	if ((thread->flags & THREAD_MODE_MASK) != THREAD_MODE_WAITING || current == _idle_thread)
+		return false;
+	//any ready thread has higher priority, or preempted thread has higher threshold
+	if (_active_threads[0] != NULL && _active_threads[0]->active_priority < thread->current_priority)
+		return false;
+
+	//wake up thread, without adding to active list
+	if (thread->flags & THREAD_TIMER_ACTIVE)
+		svc_sys_timer_destroy(&thread->timer);
+	thread->flags &= ~(THREAD_TIMER_ACTIVE | THREAD_SYNC_MASK | THREAD_MODE_MASK);
+	thread->flags |= THREAD_MODE_RUNNING;
+	thread->sync_object = NULL;
+
+#if (KERNEL_PROFILING)
+	svc_get_uptime(&thread->uptime_start);
+	time_sub(&current->uptime_start, &thread->uptime_start, &current->uptime_start);
+	time_add(&current->uptime_start, &current->uptime, &current->uptime);
+#endif //KERNEL_PROFILING
+	//current thread is not in active list, so just replace him
+	_current_thread = thread;
+	_next_thread = thread;
+	pend_switch_context();
+
+	current->flags &= ~(THREAD_MODE_MASK | THREAD_SYNC_MASK);
+	current->flags |= THREAD_MODE_WAITING | sync_type;
+	current->sync_object = sync_object;
+	svc_thread_timer_start(current, time);
+	return true;
+}
+
 #if (KERNEL_PROFILING)
 static inline void svc_thread_switch_test()
 {
@@ -616,6 +797,7 @@ static inline void svc_thread_stat()
 		++active_threads_count;
 	}
 	printf("total %d threads active\n\r", active_threads_count);
+	printf("%u preemptions saved by threshold\n\r", _preemptions_saved);
 }
 #endif //KERNEL_PROFILING
 
@@ -647,6 +829,12 @@ unsigned int svc_thread_handler(unsigned int num, unsigned int param1, unsigned
 	case THREAD_SLEEP:
 		svc_thread_sleep((TIME*)param1, THREAD_SYNC_TIMER_ONLY, NULL);
 		break;
+	case THREAD_SLEEP_UNTIL:
+		svc_thread_sleep_until((TIME*)param1);
+		break;
+	case THREAD_SET_PREEMPTION_THRESHOLD:
+		svc_thread_set_preemption_threshold((THREAD*)param1, (unsigned int)param2);
+		break;
 #if (KERNEL_PROFILING)
 	case THREAD_SWITCH_TEST:
 		svc_thread_switch_test();
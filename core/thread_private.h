@@ -40,7 +40,13 @@ typedef enum {
 	THREAD_SYNC_MUTEX =		(0x1 << 4),
 	THREAD_SYNC_EVENT =		(0x2 << 4),
 	THREAD_SYNC_SEMAPHORE =	(0x3 << 4),
-	THREAD_SYNC_QUEUE =		(0x4 << 4)
+	THREAD_SYNC_QUEUE =		(0x4 << 4),
+	THREAD_SYNC_QUEUE_BATCH =	(0x5 << 4),
+	THREAD_SYNC_RWLOCK =		(0x6 << 4),
+	THREAD_SYNC_COND =		(0x7 << 4),
+	THREAD_SYNC_IPC =			(0x8 << 4),
+	THREAD_SYNC_TOPIC =		(0x9 << 4),
+	THREAD_SYNC_SUBSCRIBER =	(0xa << 4)
 }THREAD_SYNC_TYPE;
 
 typedef struct {
@@ -52,8 +58,11 @@ typedef struct {
 	unsigned int* sp_top;											//top of stack
 	unsigned base_priority;											//base priority
 	unsigned current_priority;										//priority, adjusted by mutex
+	unsigned preemption_threshold;								//running thread can be preempted only by priority, higher than threshold
+	unsigned active_priority;										//priority in active list. Preempted thread is queued by threshold
 	TIMER timer;														//timer for thread sleep and sync objects timeouts
 	void* sync_object;												//sync object we are waiting for
+	void* sync_param;													//sync object specific data, while waiting
 	DLIST* owned_mutexes;											//owned mutexes list for nested mutex priority inheritance
 	MEM_POOL* pool;													//allocate/free data in selected pool, if NULL - in global
 #if (KERNEL_PROFILING)
@@ -76,6 +85,12 @@ void svc_thread_restore_current_priority(THREAD* thread);
 void svc_thread_sleep(TIME* time, THREAD_SYNC_TYPE sync_type, void* sync_object);
 void svc_thread_wakeup(THREAD* thread);
 THREAD* svc_thread_get_current();
+THREAD_SYNC_TYPE svc_thread_sync_type(THREAD* thread);
+//switch from current thread directly to waiting thread, bypassing active list. Current thread is put in waiting state.
+//If thread can't preempt all ready threads, return false - caller must use svc_thread_sleep/svc_thread_wakeup instead
+bool svc_thread_handoff(THREAD* thread, TIME* time, THREAD_SYNC_TYPE sync_type, void* sync_object);
+//move waiting thread to other sync object. Timeout is cancelled
+void svc_thread_change_sync_object(THREAD* thread, THREAD_SYNC_TYPE sync_type, void* sync_object);
 void svc_thread_destroy_current();
 
 /** \addtogroup user_provided user provided functions
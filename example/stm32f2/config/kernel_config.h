@@ -97,5 +97,8 @@
 #define SW_TIMER_MODULE							0
 #define SW_TIMER_STACK_SIZE					64
 #define SW_TIMER_PRIORITY						90
+//threads, dispatching sw_timer handlers. Dispatcher N priority is SW_TIMER_PRIORITY - N * SW_TIMER_DISPATCHER_PRIORITY_STEP
+#define SW_TIMER_DISPATCHERS_COUNT			1
+#define SW_TIMER_DISPATCHER_PRIORITY_STEP	10
 
 #endif // KERNEL_CONFIG_H
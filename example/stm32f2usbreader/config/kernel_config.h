@@ -88,10 +88,27 @@
 #define SD_CARD_DEBUG							0
 #define SD_CARD_DEBUG_FLOW						0
 #define SD_CARD_DEBUG_ERRORS					0
+//discard is split to erase commands of this sectors max, to fit in card busy timeout
+#define SD_CARD_ERASE_MAX_SECTORS				8192
 
 #define SDIO_IRQ_PRIORITY						6
 
 #define STORAGE_RETRY_COUNT					3
+//sectors in storage write-back cache, 0 to disable. Allocated in data pool
+#define STORAGE_CACHE_SECTORS					32
+//only requests up to this sectors count are cached (FAT, directories, metadata)
+#define STORAGE_CACHE_MAX_REQUEST				8
+//write back dirty sectors after this host idle time, 0 - only on SYNCHRONIZE CACHE or eviction
+#define STORAGE_CACHE_FLUSH_MS					1000
+//read next range of sequential stream, while host is receiving current. Holds one spare queue buffer
+#define STORAGE_READ_AHEAD						1
+//per-device I/O counters and latency histograms
+#define STORAGE_IO_STATS							1
+//----------------------------------- RAM_DISK -----------------------------------------------------------------
+//serve RAM disk of this sectors instead of SD card, 0 to disable. Pipelined driver, for storage path testing
+#define RAM_DISK_SECTORS							0
+//latency of each block request, like on real bus. 0 - complete in caller context, no pipelining
+#define RAM_DISK_LATENCY_US						500
 //----------------------------------- keyboard ----------------------------------------------------------------
 #define KEYBOARD_DEBOUNCE_MS					10
 #define KEYBOARD_POLL_MS						100
@@ -100,5 +117,8 @@
 #define SW_TIMER_MODULE							1
 #define SW_TIMER_STACK_SIZE					64
 #define SW_TIMER_PRIORITY						90
+//threads, dispatching sw_timer handlers. Dispatcher N priority is SW_TIMER_PRIORITY - N * SW_TIMER_DISPATCHER_PRIORITY_STEP
+#define SW_TIMER_DISPATCHERS_COUNT			1
+#define SW_TIMER_DISPATCHER_PRIORITY_STEP	10
 
 #endif // KERNEL_CONFIG_H
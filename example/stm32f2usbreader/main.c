@@ -3,6 +3,7 @@
 #include "gpio_user.h"
 #include "gpio.h"
 #include "sd_card.h"
+#include "ram_disk.h"
 #include "storage.h"
 #include "usbd.h"
 #include "usb_msc.h"
@@ -19,7 +20,11 @@ const SCSI_DESCRIPTOR _scsi_descriptor = {
 	"MY_CMPNY Flash cardreader"
 };
 
+#if (RAM_DISK_SECTORS)
+RAM_DISK*					_ram_disk;
+#else
 SD_CARD*						_sd_card;
+#endif //RAM_DISK_SECTORS
 STORAGE_HOST_CB			_storage_cb;
 
 USBD*							_usbd;
@@ -61,20 +66,28 @@ void usb_state_changed(USBD_STATE state, USBD_STATE prior_state, void* param)
 
 void application_init(void)
 {
+	STORAGE* storage;
 	gpio_user_init();
 
+#if (RAM_DISK_SECTORS)
+	_ram_disk = ram_disk_create(RAM_DISK_SECTORS);
+	ram_disk_set_latency_us(_ram_disk, RAM_DISK_LATENCY_US);
+	storage = ram_disk_get_storage(_ram_disk);
+#else
 	_sd_card = sd_card_create(SDIO_1, SDIO_IRQ_PRIORITY);
+	storage = sd_card_get_storage(_sd_card);
+#endif //RAM_DISK_SECTORS
 
 	_storage_cb.state_changed = io_monitor;
 	_storage_cb.media_state_changed = NULL;
 	_storage_cb.param = NULL;
-	storage_register_handler(sd_card_get_storage(_sd_card), &_storage_cb);
+	storage_register_handler(storage, &_storage_cb);
 
 	_usbd = usbd_create(USB_1, _p_usb_descriptors, USB_IRQ_PRIORITY);
 	_state_cb.state_handler = usb_state_changed;
 	_state_cb.param = NULL;
 	usbd_register_state_callback(_usbd, &_state_cb);
-	_msc = usb_msc_create(_usbd, 1, sd_card_get_storage(_sd_card), (P_SCSI_DESCRIPTOR)&_scsi_descriptor);
+	_msc = usb_msc_create(_usbd, 1, storage, (P_SCSI_DESCRIPTOR)&_scsi_descriptor);
 }
 
 void idle_task(void)
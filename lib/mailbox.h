@@ -0,0 +1,138 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+/** \addtogroup lib_mailbox latest-value mailbox
+	mailbox is holding only latest posted value. Producer is never blocked, old
+	value is just overwritten. It's useful for sensors and state, when consumer
+	needs only newest value.
+
+	Mailbox can be posted from any context, including IRQ, by many producers.
+	Posting is made with disabled interrupts, so value size must be small.
+	Reader is lock-free: value is copied, and copy is repeated, if mailbox
+	was posted while reading. So, reader always gets consistent snapshot.
+
+	If wakeup event is attached, it's set on every post.
+
+	unsigned int seq = 0;
+	for (;;)
+	{
+		event_clear(event);
+		if (mailbox_peek(mb, &value, &seq))
+			<process value>
+		event_wait(event, &timeout);
+	}
+	\{
+	\}
+ */
+
+#include "types.h"
+#include "cc_macro.h"
+#include "irq.h"
+#include "event.h"
+#include <string.h>
+
+typedef struct {
+	//odd while posting, 0 - nothing posted yet
+	volatile unsigned int seq;
+	unsigned int size;
+	HANDLE wakeup;
+}MAILBOX_HEADER;
+
+typedef struct {
+	MAILBOX_HEADER header;
+	char data[((unsigned int)-1) >> 1];
+}MAILBOX;
+
+/** \addtogroup lib_mailbox latest-value mailbox
+	\{
+ */
+
+/**
+	\brief initialize mailbox structure
+	\param mb: pointer to allocated \ref MAILBOX structure with size bytes of data
+	\param size: value size in bytes
+	\param wakeup: event, set on every post. Can be INVALID_HANDLE
+	\retval none
+*/
+__STATIC_INLINE void mailbox_init(MAILBOX* mb, unsigned int size, HANDLE wakeup)
+{
+	mb->header.seq = 0;
+	mb->header.size = size;
+	mb->header.wakeup = wakeup;
+}
+
+/**
+	\brief post value to mailbox, overwriting previous. Can be called from any context
+	\param mb: pointer to initialized \ref MAILBOX structure
+	\param data: value
+	\retval none
+*/
+__STATIC_INLINE void mailbox_post(MAILBOX* mb, const void* data)
+{
+	CRITICAL_ENTER;
+	++mb->header.seq;
+	__MEMORY_BARRIER();
+	memcpy(mb->data, data, mb->header.size);
+	__MEMORY_BARRIER();
+	++mb->header.seq;
+	CRITICAL_LEAVE;
+	if (mb->header.wakeup)
+		event_set(mb->header.wakeup);
+}
+
+/**
+	\brief get latest value from mailbox
+	\param mb: pointer to initialized \ref MAILBOX structure
+	\param data: buffer for value
+	\param seq: sequence of last readed value, updated on return. Must be 0 before first call
+	\retval \b true if value is posted after last peek, \b false if value is not changed or nothing is posted
+*/
+__STATIC_INLINE bool mailbox_peek(MAILBOX* mb, void* data, unsigned int* seq)
+{
+	unsigned int start, end;
+	do {
+		start = mb->header.seq;
+		//sequence must be read before data
+		__MEMORY_BARRIER();
+		memcpy(data, mb->data, mb->header.size);
+		//data must be read before sequence is checked again
+		__MEMORY_BARRIER();
+		end = mb->header.seq;
+	} while ((start & 1) || start != end);
+	if (start == *seq)
+		return false;
+	*seq = start;
+	return true;
+}
+
+/**
+	\}
+ */
+
+#endif // MAILBOX_H
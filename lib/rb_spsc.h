@@ -0,0 +1,196 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RB_SPSC_H
+#define RB_SPSC_H
+
+/** \addtogroup lib_rb_spsc lock-free ring buffer
+	single producer/single consumer ring buffer routines
+
+	Producer and consumer can run in different contexts, for example,
+	UART ISR is producer and thread is consumer. No interrupts disabling is
+	required, because head is written only by producer and tail - only by consumer.
+
+	Size of data must be power of 2. head and tail are free-running counters,
+	wrapped by mask, so all size bytes can be used.
+
+	If wakeup event is attached, it's set on every write. Consumer
+	must call event_clear before checking for data, to not miss wakeup:
+
+	for (;;)
+	{
+		event_clear(event);
+		if ((size = rb_spsc_read(rb, buf, sizeof(buf))) != 0)
+			break;
+		event_wait(event, &timeout);
+	}
+	\{
+	\}
+ */
+
+#include "types.h"
+#include "cc_macro.h"
+#include "event.h"
+#include <string.h>
+
+typedef struct {
+	volatile unsigned int head, tail;
+	unsigned int mask;
+	HANDLE wakeup;
+}RB_SPSC_HEADER;
+
+typedef struct {
+	RB_SPSC_HEADER header;
+	char data[((unsigned int)-1) >> 1];
+}RB_SPSC;
+
+/** \addtogroup lib_rb_spsc lock-free ring buffer
+	\{
+ */
+
+/**
+	\brief initialize ring buffer structure
+	\param rb: pointer to allocated \ref RB_SPSC structure
+	\param size: ring buffer size in bytes. Must be power of 2
+	\param wakeup: event, set on every write. Can be INVALID_HANDLE
+	\retval none
+*/
+__STATIC_INLINE void rb_spsc_init(RB_SPSC* rb, unsigned int size, HANDLE wakeup)
+{
+	rb->header.head = rb->header.tail = 0;
+	rb->header.mask = size - 1;
+	rb->header.wakeup = wakeup;
+}
+
+/**
+	\brief count of bytes in ring buffer
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\retval bytes count
+*/
+__STATIC_INLINE unsigned int rb_spsc_used(RB_SPSC* rb)
+{
+	return rb->header.head - rb->header.tail;
+}
+
+/**
+	\brief count of free bytes in ring buffer
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\retval bytes count
+*/
+__STATIC_INLINE unsigned int rb_spsc_free(RB_SPSC* rb)
+{
+	return rb->header.mask + 1 - (rb->header.head - rb->header.tail);
+}
+
+/**
+	\brief check, if ring buffer is empty
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\retval \b true if empty
+*/
+__STATIC_INLINE bool rb_spsc_is_empty(RB_SPSC* rb)
+{
+	return rb->header.head == rb->header.tail;
+}
+
+/**
+	\brief check, if ring buffer is full
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\retval \b true if full
+*/
+__STATIC_INLINE bool rb_spsc_is_full(RB_SPSC* rb)
+{
+	return rb->header.head - rb->header.tail > rb->header.mask;
+}
+
+/**
+	\brief write data to ring buffer. Producer side only
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\param buf: data to write
+	\param size: data size in bytes
+	\retval count of written bytes. Can be less, than size, if ring buffer is full
+*/
+__STATIC_INLINE unsigned int rb_spsc_write(RB_SPSC* rb, const char* buf, unsigned int size)
+{
+	unsigned int head = rb->header.head;
+	unsigned int free = rb->header.mask + 1 - (head - rb->header.tail);
+	unsigned int pos, chunk;
+	if (size > free)
+		size = free;
+	if (size)
+	{
+		//tail must be read before slots are overwritten
+		__MEMORY_BARRIER();
+		pos = head & rb->header.mask;
+		chunk = rb->header.mask + 1 - pos;
+		if (chunk > size)
+			chunk = size;
+		memcpy(rb->data + pos, buf, chunk);
+		memcpy(rb->data, buf + chunk, size - chunk);
+		//data must be visible before head is published
+		__MEMORY_BARRIER();
+		rb->header.head = head + size;
+		if (rb->header.wakeup)
+			event_set(rb->header.wakeup);
+	}
+	return size;
+}
+
+/**
+	\brief read data from ring buffer. Consumer side only
+	\param rb: pointer to initialized \ref RB_SPSC structure
+	\param buf: buffer for data
+	\param size: buffer size in bytes
+	\retval count of readed bytes. Can be less, than size, or 0, if ring buffer is empty
+*/
+__STATIC_INLINE unsigned int rb_spsc_read(RB_SPSC* rb, char* buf, unsigned int size)
+{
+	unsigned int tail = rb->header.tail;
+	unsigned int used = rb->header.head - tail;
+	unsigned int pos, chunk;
+	if (size > used)
+		size = used;
+	if (size)
+	{
+		//head must be read before data
+		__MEMORY_BARRIER();
+		pos = tail & rb->header.mask;
+		chunk = rb->header.mask + 1 - pos;
+		if (chunk > size)
+			chunk = size;
+		memcpy(buf, rb->data + pos, chunk);
+		memcpy(buf + chunk, rb->data, size - chunk);
+		//data must be readed before slots are released to producer
+		__MEMORY_BARRIER();
+		rb->header.tail = tail + size;
+	}
+	return size;
+}
+
+/**
+	\}
+ */
+
+#endif // RB_SPSC_H
@@ -0,0 +1,164 @@
+/*
+	M-Kernel - embedded RTOS
+	Copyright (c) 2011-2012, Alexey Kramarenko
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+		list of conditions and the following disclaimer.
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the documentation
+		and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+	ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+	WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+	ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+	(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+	LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+	ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+	(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+	SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TRIPLE_BUF_H
+#define TRIPLE_BUF_H
+
+/** \addtogroup lib_triple_buf triple buffer
+	triple buffer is exchanging large structures between producer and consumer
+	without copy. There are 3 buffers: one is filled by producer, one is owned by
+	consumer, and last one is holding newest published data.
+
+	Producer is never blocked and can publish from any context, including IRQ.
+	Consumer always gets consistent snapshot, which is not changed until next
+	triple_buf_read. Only one producer and one consumer are supported.
+
+	Exchange is made by swapping single index with interrupts disabled for few
+	instructions. Data is never copied.
+
+	producer:
+	STATE* state = triple_buf_write_buf(tb);
+	<fill state>
+	triple_buf_publish(tb);
+
+	consumer:
+	STATE* state = triple_buf_read(tb);
+	if (state)
+		<process state>
+	\{
+	\}
+ */
+
+#include "types.h"
+#include "cc_macro.h"
+#include "irq.h"
+#include "event.h"
+
+#define TRIPLE_BUF_FRESH								(1 << 2)
+#define TRIPLE_BUF_INDEX_MASK							0x3
+
+typedef struct {
+	void* bufs[3];
+	//owned by producer
+	unsigned int write_idx;
+	//owned by consumer
+	unsigned int read_idx;
+	bool valid;
+	//newest published buffer
+	volatile unsigned int middle;
+	HANDLE wakeup;
+}TRIPLE_BUF;
+
+/** \addtogroup lib_triple_buf triple buffer
+	\{
+ */
+
+/**
+	\brief initialize triple buffer structure
+	\param tb: pointer to allocated \ref TRIPLE_BUF structure
+	\param mem: memory for 3 buffers
+	\param size: size of single buffer in bytes
+	\param wakeup: event, set on every publish. Can be INVALID_HANDLE
+	\retval none
+*/
+__STATIC_INLINE void triple_buf_init(TRIPLE_BUF* tb, void* mem, unsigned int size, HANDLE wakeup)
+{
+	tb->bufs[0] = mem;
+	tb->bufs[1] = (char*)mem + size;
+	tb->bufs[2] = (char*)mem + 2 * size;
+	tb->write_idx = 0;
+	tb->middle = 1;
+	tb->read_idx = 2;
+	tb->valid = false;
+	tb->wakeup = wakeup;
+}
+
+/**
+	\brief get buffer to fill. Producer side only
+	\param tb: pointer to initialized \ref TRIPLE_BUF structure
+	\retval buffer, owned by producer until triple_buf_publish
+*/
+__STATIC_INLINE void* triple_buf_write_buf(TRIPLE_BUF* tb)
+{
+	return tb->bufs[tb->write_idx];
+}
+
+/**
+	\brief publish filled buffer. Producer side only
+	\param tb: pointer to initialized \ref TRIPLE_BUF structure
+	\retval none
+*/
+__STATIC_INLINE void triple_buf_publish(TRIPLE_BUF* tb)
+{
+	unsigned int idx;
+	//data must be visible before buffer is published
+	__MEMORY_BARRIER();
+	CRITICAL_ENTER;
+	idx = tb->middle & TRIPLE_BUF_INDEX_MASK;
+	tb->middle = tb->write_idx | TRIPLE_BUF_FRESH;
+	CRITICAL_LEAVE;
+	tb->write_idx = idx;
+	if (tb->wakeup)
+		event_set(tb->wakeup);
+}
+
+/**
+	\brief check, if new buffer is published after last read
+	\param tb: pointer to initialized \ref TRIPLE_BUF structure
+	\retval \b true if new buffer is published
+*/
+__STATIC_INLINE bool triple_buf_is_fresh(TRIPLE_BUF* tb)
+{
+	return (tb->middle & TRIPLE_BUF_FRESH) != 0;
+}
+
+/**
+	\brief get newest published buffer. Consumer side only
+	\param tb: pointer to initialized \ref TRIPLE_BUF structure
+	\retval buffer, owned by consumer until next triple_buf_read, NULL if nothing is published yet
+*/
+__STATIC_INLINE void* triple_buf_read(TRIPLE_BUF* tb)
+{
+	unsigned int idx;
+	if (tb->middle & TRIPLE_BUF_FRESH)
+	{
+		CRITICAL_ENTER;
+		idx = tb->middle & TRIPLE_BUF_INDEX_MASK;
+		tb->middle = tb->read_idx;
+		CRITICAL_LEAVE;
+		tb->read_idx = idx;
+		tb->valid = true;
+		//index must be read before data
+		__MEMORY_BARRIER();
+	}
+	return tb->valid ? tb->bufs[tb->read_idx] : NULL;
+}
+
+/**
+	\}
+ */
+
+#endif // TRIPLE_BUF_H
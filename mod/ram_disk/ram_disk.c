@@ -0,0 +1,291 @@
+#include "ram_disk.h"
+#include <string.h>
+#include "dbg.h"
+#include "kernel_config.h"
+#include "irq.h"
+#include "mem_private.h"
+#include "mem.h"
+#include "error.h"
+
+bool ram_disk_check_media(void* param);
+void ram_disk_cancel_io(void* param);
+STORAGE_STATUS ram_disk_read_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count);
+STORAGE_STATUS ram_disk_write_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count);
+void ram_disk_stop(void* param);
+STORAGE_STATUS ram_disk_discard(void* param, unsigned long addr, unsigned long count);
+void ram_disk_timer_handler(void* param);
+
+static const  STORAGE_DEVICE_DESCRIPTOR _storage_device_descriptor = {
+	STORAGE_DEVICE_FLAG_REMOVABLE | STORAGE_DEVICE_FLAG_PIPELINED,
+	RAM_DISK_SECTOR_SIZE,
+	RAM_DISK_IO_DEPTH
+};
+
+static const STORAGE_DRIVER_CB _storage_cb = {
+	ram_disk_check_media,
+	ram_disk_cancel_io,
+	//on_storage_prepare_read
+	NULL,
+	ram_disk_read_blocks,
+	//on_storage_read_done
+	NULL,
+	//on_storage_prepare_write
+	NULL,
+	ram_disk_write_blocks,
+	//on_storage_write_done
+	NULL,
+	//on_write_cache
+	NULL,
+	ram_disk_stop,
+	ram_disk_discard
+};
+
+RAM_DISK* ram_disk_create(unsigned long sectors)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)sys_alloc(sizeof(RAM_DISK));
+	if (ram_disk)
+	{
+		ram_disk->data = (char*)malloc(sectors * RAM_DISK_SECTOR_SIZE);
+		if (ram_disk->data == NULL)
+		{
+			sys_free(ram_disk);
+			error(ERROR_MEM_OUT_OF_HEAP, "RAM_DISK");
+			return NULL;
+		}
+		memset(ram_disk->data, 0, sectors * RAM_DISK_SECTOR_SIZE);
+		ram_disk->media.num_sectors = sectors;
+		strcpy(ram_disk->media.serial_number, "RAMDISK00001");
+		ram_disk->media.flags = 0;
+		ram_disk->media.discard_max_sectors = 0;
+		ram_disk->media.discard_granularity = 1;
+		ram_disk->latency.sec = ram_disk->latency.usec = 0;
+		ram_disk->timer.callback = ram_disk_timer_handler;
+		ram_disk->timer.param = ram_disk;
+		ram_disk->timer_active = false;
+		ram_disk->io_head = ram_disk->io_count = 0;
+		ram_disk->error = STORAGE_STATUS_OK;
+		ram_disk->error_skip = ram_disk->error_count = 0;
+		ram_disk->media_present = false;
+
+		ram_disk->storage = storage_create(&_storage_device_descriptor, (P_STORAGE_DRIVER_CB)&_storage_cb, (void*)ram_disk);
+		ram_disk_insert(ram_disk);
+	}
+	else
+		error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, "RAM_DISK");
+	return ram_disk;
+}
+
+void ram_disk_destroy(RAM_DISK* ram_disk)
+{
+	ram_disk_cancel_io(ram_disk);
+	storage_destroy(ram_disk->storage);
+	free(ram_disk->data);
+	sys_free(ram_disk);
+}
+
+STORAGE* ram_disk_get_storage(RAM_DISK* ram_disk)
+{
+	return ram_disk->storage;
+}
+
+char* ram_disk_get_data(RAM_DISK* ram_disk)
+{
+	return ram_disk->data;
+}
+
+void ram_disk_set_latency_us(RAM_DISK* ram_disk, unsigned int latency_us)
+{
+	us_to_time(latency_us, &ram_disk->latency);
+}
+
+void ram_disk_inject_error(RAM_DISK* ram_disk, STORAGE_STATUS status, unsigned int error_skip, unsigned int error_count)
+{
+	CRITICAL_ENTER;
+	ram_disk->error = status;
+	ram_disk->error_skip = error_skip;
+	ram_disk->error_count = error_count;
+	CRITICAL_LEAVE;
+}
+
+void ram_disk_insert(RAM_DISK* ram_disk)
+{
+	if (!ram_disk->media_present)
+	{
+		ram_disk->media_present = true;
+		storage_insert_media(ram_disk->storage, &ram_disk->media);
+	}
+}
+
+void ram_disk_eject(RAM_DISK* ram_disk)
+{
+	if (ram_disk->media_present)
+	{
+		ram_disk->media_present = false;
+		ram_disk_cancel_io(ram_disk);
+		storage_eject_media(ram_disk->storage);
+	}
+}
+
+static inline STORAGE_STATUS ram_disk_next_status(RAM_DISK* ram_disk)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	CRITICAL_ENTER;
+	if (ram_disk->error_count)
+	{
+		if (ram_disk->error_skip)
+			--ram_disk->error_skip;
+		else
+		{
+			--ram_disk->error_count;
+			status = ram_disk->error;
+		}
+	}
+	CRITICAL_LEAVE;
+	return status;
+}
+
+static inline void ram_disk_complete(RAM_DISK* ram_disk, RAM_DISK_IO* io)
+{
+	if (io->writing)
+		storage_buffer_writed(ram_disk->storage, io->buf, io->status);
+	else
+		storage_buffer_readed(ram_disk->storage, io->buf, io->status);
+}
+
+static STORAGE_STATUS ram_disk_request(RAM_DISK* ram_disk, char* buf, STORAGE_STATUS status, bool writing)
+{
+	RAM_DISK_IO io;
+	bool start = false;
+	io.buf = buf;
+	io.status = status;
+	io.writing = writing;
+	//no latency - complete in caller context
+	if (ram_disk->latency.sec == 0 && ram_disk->latency.usec == 0)
+	{
+		ram_disk_complete(ram_disk, &io);
+		return STORAGE_STATUS_OK;
+	}
+	CRITICAL_ENTER;
+	if (ram_disk->io_count < RAM_DISK_IO_DEPTH)
+	{
+		ram_disk->io[(ram_disk->io_head + ram_disk->io_count++) % RAM_DISK_IO_DEPTH] = io;
+		if (!ram_disk->timer_active)
+			start = ram_disk->timer_active = true;
+		status = STORAGE_STATUS_OK;
+	}
+	else
+		status = STORAGE_STATUS_OPERATION_UNEXPECTED;
+	CRITICAL_LEAVE;
+	if (start)
+	{
+		ram_disk->timer.time.sec = ram_disk->latency.sec;
+		ram_disk->timer.time.usec = ram_disk->latency.usec;
+		sys_timer_create(&ram_disk->timer);
+	}
+	return status;
+}
+
+void ram_disk_timer_handler(void* param)
+{
+	//called in sys_timer isr. Requests are completed one per latency period, like on real serial bus
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	RAM_DISK_IO io;
+	//cancelled, while timer was firing
+	if (ram_disk->io_count == 0)
+	{
+		ram_disk->timer_active = false;
+		return;
+	}
+	io = ram_disk->io[ram_disk->io_head];
+	ram_disk->io_head = (ram_disk->io_head + 1) % RAM_DISK_IO_DEPTH;
+	--ram_disk->io_count;
+	if (ram_disk->io_count)
+	{
+		ram_disk->timer.time.sec = ram_disk->latency.sec;
+		ram_disk->timer.time.usec = ram_disk->latency.usec;
+		svc_sys_timer_create(&ram_disk->timer);
+	}
+	else
+		ram_disk->timer_active = false;
+	ram_disk_complete(ram_disk, &io);
+}
+
+bool ram_disk_check_media(void* param)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	return ram_disk->media_present;
+}
+
+void ram_disk_cancel_io(void* param)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	RAM_DISK_IO io[RAM_DISK_IO_DEPTH];
+	unsigned int i, head, count;
+	bool active;
+	CRITICAL_ENTER;
+	active = ram_disk->timer_active;
+	head = ram_disk->io_head;
+	count = ram_disk->io_count;
+	for (i = 0; i < count; ++i)
+		io[i] = ram_disk->io[(head + i) % RAM_DISK_IO_DEPTH];
+	ram_disk->timer_active = false;
+	ram_disk->io_count = 0;
+	CRITICAL_LEAVE;
+	//no-op, if timer is already fired
+	if (active)
+		sys_timer_destroy(&ram_disk->timer);
+	//don't leave storage waiting for buffers, that will never complete
+	for (i = 0; i < count; ++i)
+	{
+		io[i].status = STORAGE_STATUS_NO_MEDIA;
+		ram_disk_complete(ram_disk, &io[i]);
+	}
+}
+
+STORAGE_STATUS ram_disk_read_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	STORAGE_STATUS status;
+	if (!ram_disk->media_present)
+		return STORAGE_STATUS_NO_MEDIA;
+	if (addr + blocks_count > ram_disk->media.num_sectors)
+		return STORAGE_STATUS_INVALID_ADDRESS;
+	status = ram_disk_next_status(ram_disk);
+	if (status == STORAGE_STATUS_OK)
+		memcpy(buf, ram_disk->data + addr * RAM_DISK_SECTOR_SIZE, blocks_count * RAM_DISK_SECTOR_SIZE);
+	return ram_disk_request(ram_disk, buf, status, false);
+}
+
+STORAGE_STATUS ram_disk_write_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	STORAGE_STATUS status;
+	if (!ram_disk->media_present)
+		return STORAGE_STATUS_NO_MEDIA;
+	if (addr + blocks_count > ram_disk->media.num_sectors)
+		return STORAGE_STATUS_INVALID_ADDRESS;
+	status = ram_disk_next_status(ram_disk);
+	if (status == STORAGE_STATUS_OK)
+		memcpy(ram_disk->data + addr * RAM_DISK_SECTOR_SIZE, buf, blocks_count * RAM_DISK_SECTOR_SIZE);
+	return ram_disk_request(ram_disk, buf, status, true);
+}
+
+void ram_disk_stop(void* param)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	ram_disk_cancel_io(ram_disk);
+	//media is inserted back by ram_disk_insert
+	ram_disk->media_present = false;
+}
+
+STORAGE_STATUS ram_disk_discard(void* param, unsigned long addr, unsigned long count)
+{
+	RAM_DISK* ram_disk = (RAM_DISK*)param;
+	if (!ram_disk->media_present)
+		return STORAGE_STATUS_NO_MEDIA;
+	if (addr + count > ram_disk->media.num_sectors)
+		return STORAGE_STATUS_INVALID_ADDRESS;
+	//like most SD cards, discarded sectors are readed as zeroes
+	memset(ram_disk->data + addr * RAM_DISK_SECTOR_SIZE, 0, count * RAM_DISK_SECTOR_SIZE);
+	return ram_disk_next_status(ram_disk);
+}
@@ -0,0 +1,47 @@
+#ifndef RAM_DISK_H
+#define RAM_DISK_H
+
+#include "dev.h"
+#include "storage.h"
+#include "sys_timer.h"
+
+#define RAM_DISK_SECTOR_SIZE					512
+//completions, waiting for latency timer. Storage pipeline depth is limited by it
+#define RAM_DISK_IO_DEPTH						8
+
+typedef struct {
+	char* buf;
+	STORAGE_STATUS status;
+	bool writing;
+}RAM_DISK_IO;
+
+typedef struct {
+	STORAGE* storage;
+	char* data;
+	STORAGE_MEDIA_DESCRIPTOR media;
+	bool media_present;
+	//latency of each block request. 0 - complete in caller context
+	TIME latency;
+	TIMER timer;
+	bool timer_active;
+	RAM_DISK_IO io[RAM_DISK_IO_DEPTH];
+	unsigned int io_head, io_count;
+	//error injection
+	STORAGE_STATUS error;
+	unsigned int error_skip, error_count;
+}RAM_DISK;
+
+RAM_DISK* ram_disk_create(unsigned long sectors);
+void ram_disk_destroy(RAM_DISK* ram_disk);
+
+STORAGE* ram_disk_get_storage(RAM_DISK* ram_disk);
+char* ram_disk_get_data(RAM_DISK* ram_disk);
+
+void ram_disk_set_latency_us(RAM_DISK* ram_disk, unsigned int latency_us);
+//fail error_count block requests with status after error_skip successful requests
+void ram_disk_inject_error(RAM_DISK* ram_disk, STORAGE_STATUS status, unsigned int error_skip, unsigned int error_count);
+
+void ram_disk_insert(RAM_DISK* ram_disk);
+void ram_disk_eject(RAM_DISK* ram_disk);
+
+#endif // RAM_DISK_H
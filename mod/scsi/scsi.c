@@ -213,6 +213,35 @@ static inline bool scsi_cmd_read_capacity(SCSI* scsi)
 	return res;
 }
 
+static inline bool scsi_cmd_service_action_in16(SCSI* scsi)
+{
+	bool res = false;
+	if (scsi->cmd.cmd_type == SCSI_CMD_16)
+	{
+		switch (scsi->cmd.flags & SCSI_SERVICE_ACTION_MASK)
+		{
+		case SCSI_SERVICE_ACTION_READ_CAPACITY16:
+			if (storage_check_media(scsi->storage))
+			{
+				res = true;
+				scsi_fill_capacity16_page(scsi);
+#if (SCSI_DEBUG_FLOW)
+	printf("SCSI: read capacity16 0x%08X sectors, sector size: %d\n\r", storage_get_media_descriptor(scsi->storage)->num_sectors,
+			 storage_get_device_descriptor(scsi->storage)->sector_size);
+#endif
+			}
+			else
+				scsi_error(scsi, SENSE_KEY_NOT_READY, ASQ_MEDIUM_NOT_PRESENT);
+			break;
+		default:
+			scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_CDB);
+		}
+	}
+	else
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_CDB_DECRYPTION_ERROR);
+	return res;
+}
+
 static inline bool scsi_cmd_read_format_capacity(SCSI* scsi)
 {
 	bool res = false;
@@ -241,10 +270,10 @@ static inline bool scsi_cmd_synchronize_cache(SCSI* scsi)
 	bool res = false;
 	if (scsi->cmd.cmd_type == SCSI_CMD_10)
 	{
-		storage_write_cache(scsi->storage);
-		res = true;
+		res = scsi_synchronize_cache(scsi);
 #if (SCSI_DEBUG_FLOW)
-		printf("SCSI: synchronize cache\n\r");
+		if (res)
+			printf("SCSI: synchronize cache\n\r");
 #endif
 	}
 	else
@@ -252,6 +281,25 @@ static inline bool scsi_cmd_synchronize_cache(SCSI* scsi)
 	return res;
 }
 
+static inline bool scsi_cmd_unmap(SCSI* scsi)
+{
+	bool res = false;
+	if (scsi->cmd.cmd_type == SCSI_CMD_10)
+	{
+		if (storage_is_discard_supported(scsi->storage))
+			res = scsi_unmap(scsi, scsi->cmd.len);
+		else
+			scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_COMMAND_OPERATION_CODE);
+	}
+	else
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_CDB_DECRYPTION_ERROR);
+
+#if (SCSI_DEBUG_FLOW)
+	printf("SCSI unmap, %d byte(s) parameter list\n\r", scsi->cmd.len);
+#endif //SCSI_DEBUG_FLOW
+	return res;
+}
+
 static inline bool scsi_cmd_write6(SCSI* scsi)
 {
 	bool res = false;
@@ -386,6 +434,20 @@ static inline bool scsi_cmd_inquiry(SCSI* scsi)
 				scsi_fill_evpd_page_80(scsi);
 				res = true;
 				break;
+			case INQUIRY_VITAL_PAGE_BLOCK_LIMITS:
+				if (storage_is_discard_supported(scsi->storage))
+				{
+					scsi_fill_evpd_page_b0(scsi);
+					res = true;
+				}
+				break;
+			case INQUIRY_VITAL_PAGE_LOGICAL_BLOCK_PROVISIONING:
+				if (storage_is_discard_supported(scsi->storage))
+				{
+					scsi_fill_evpd_page_b2(scsi);
+					res = true;
+				}
+				break;
 			default:
 				break;
 			}
@@ -415,25 +477,13 @@ static inline bool scsi_cmd_mode_select6(SCSI* scsi)
 {
 	bool res = false;
 	if (scsi->cmd.cmd_type == SCSI_CMD_6)
-	{
-		switch((scsi->cmd.address >> 8) & 0x3f)
-		{
-		case 0x1c:
-			res = true;
-			break;
-		default:
-			scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_CDB);
-#if (SCSI_DEBUG_UNSUPPORTED)
-			printf("SCSI: Mode select: unsupported page 0x%02X\n\r", (scsi->cmd.address >> 8) & 0x3f);
-#endif
-		}
-	}
+		res = scsi_mode_select(scsi, scsi->cmd.len, SCSI_MODE_HEADER6_SIZE);
 	else
 		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_CDB_DECRYPTION_ERROR);
 
 #if (SCSI_DEBUG_FLOW)
 	if (res)
-		printf("SCSI: Mode select 6 page 0x%02X\n\r", (scsi->cmd.address >> 8) & 0x3f);
+		printf("SCSI: Mode select 6, %d byte(s)\n\r", scsi->cmd.len);
 #endif
 	return res;
 }
@@ -442,25 +492,13 @@ static inline bool scsi_cmd_mode_select10(SCSI* scsi)
 {
 	bool res = false;
 	if (scsi->cmd.cmd_type == SCSI_CMD_10)
-	{
-		switch((scsi->cmd.address >> 24) & 0x3f)
-		{
-		case 0x1c:
-			res = true;
-			break;
-		default:
-			scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_CDB);
-#if (SCSI_DEBUG_UNSUPPORTED)
-			printf("SCSI: Mode select: unsupported page 0x%02X\n\r", (scsi->cmd.address >> 8) & 0x3f);
-#endif
-		}
-	}
+		res = scsi_mode_select(scsi, scsi->cmd.len, SCSI_MODE_HEADER10_SIZE);
 	else
 		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_CDB_DECRYPTION_ERROR);
 
 #if (SCSI_DEBUG_FLOW)
 	if (res)
-		printf("SCSI: Mode select 10 page 0x%02X\n\r", (scsi->cmd.address >> 8) & 0x3f);
+		printf("SCSI: Mode select 10, %d byte(s)\n\r", scsi->cmd.len);
 #endif
 	return res;
 }
@@ -472,6 +510,10 @@ static inline bool scsi_cmd_mode_sense6(SCSI* scsi)
 	{
 		switch((scsi->cmd.address >> 8) & 0x3f)
 		{
+		case 0x08:
+			scsi_fill_sense_page_08(scsi);
+			res = true;
+			break;
 		case 0x1c:
 			scsi_fill_sense_page_1c(scsi);
 			res = true;
@@ -504,6 +546,10 @@ static inline bool scsi_cmd_mode_sense10(SCSI* scsi)
 	{
 		switch((scsi->cmd.address >> 24) & 0x3f)
 		{
+		case 0x08:
+			scsi_fill_sense_page_08(scsi);
+			res = true;
+			break;
 		case 0x1c:
 			scsi_fill_sense_page_1c(scsi);
 			res = true;
@@ -618,6 +664,9 @@ bool scsi_cmd(SCSI* scsi, char* cmd_buf, uint8_t cmd_size)
 		case SCSI_CMD_READ_FORMAT_CAPACITY:
 			res = scsi_cmd_read_format_capacity(scsi);
 			break;
+		case SCSI_CMD_SERVICE_ACTION_IN16:
+			res = scsi_cmd_service_action_in16(scsi);
+			break;
 		case SCSI_CMD_SYNCHRONIZE_CACHE:
 			res = scsi_cmd_synchronize_cache(scsi);
 			break;
@@ -633,6 +682,9 @@ bool scsi_cmd(SCSI* scsi, char* cmd_buf, uint8_t cmd_size)
 		case SCSI_CMD_WRITE16:
 			res = scsi_cmd_write16(scsi);
 			break;
+		case SCSI_CMD_UNMAP:
+			res = scsi_cmd_unmap(scsi);
+			break;
 		case SCSI_CMD_VERIFY6:
 			res = scsi_cmd_verify6(scsi);
 			break;
@@ -28,6 +28,7 @@
 
 #define SCSI_CMD_SYNCHRONIZE_CACHE					0x35
 #define SCSI_CMD_WRITE_BUFFER							0x3B
+#define SCSI_CMD_UNMAP									0x42
 
 #define SCSI_CMD_MODE_SELECT10						0x55
 #define SCSI_CMD_MODE_SENSE10							0x5A
@@ -35,6 +36,7 @@
 #define SCSI_CMD_READ16									0x88
 #define SCSI_CMD_WRITE16								0x8A
 #define SCSI_CMD_VERIFY16								0x8F
+#define SCSI_CMD_SERVICE_ACTION_IN16				0x9E
 
 #define SCSI_CMD_READ12									0xA8
 #define SCSI_CMD_WRITE12								0xAA
@@ -45,11 +47,27 @@
 
 #define SCSI_VERIFY_BYTCHK								(1 << 1)
 
+//service action in flags field
+#define SCSI_SERVICE_ACTION_MASK						0x1f
+#define SCSI_SERVICE_ACTION_READ_CAPACITY16		0x10
+
+//header + block descriptors. Parameter list must fit in one storage block
+#define SCSI_UNMAP_HEADER_SIZE						8
+#define SCSI_UNMAP_DESCRIPTOR_SIZE					16
+#define SCSI_UNMAP_MAX_DESCRIPTORS					31
+
+//mode parameter header, followed by block descriptors and pages
+#define SCSI_MODE_HEADER6_SIZE						4
+#define SCSI_MODE_HEADER10_SIZE						8
+#define SCSI_MODE_PAGE_WCE							0x04
+
 //codes for EPVD
 #define INQUIRY_VITAL_PAGE_SUPPORTED_PAGES		0x00
 #define INQUIRY_VITAL_PAGE_SERIAL_NUM				0x80
 #define INQUIRY_VITAL_PAGE_ASCII_OPERATIONS		0x82
 #define INQUIRY_VITAL_PAGE_DEVICE_INFO				0x83
+#define INQUIRY_VITAL_PAGE_BLOCK_LIMITS				0xB0
+#define INQUIRY_VITAL_PAGE_LOGICAL_BLOCK_PROVISIONING	0xB2
 
 //sense key for error recovery
 #define SENSE_KEY_NO_SENSE								0x00
@@ -76,6 +94,7 @@
 #define ASQ_ERROR_LOG_OVERFLOW						0x0a00
 #define ASQ_UNRECOVERED_READ_ERROR					0x1100
 #define ASQ_READ_RETRIES_EXHAUSTED					0x1101
+#define ASQ_PARAMETER_LIST_LENGTH_ERROR			0x1a00
 #define ASQ_MISCOMPARE_DURING_VERIFY_OPERATION	0x1d00
 #define ASQ_INVALID_COMMAND_OPERATION_CODE		0x2000
 #define ASQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE	0x2101
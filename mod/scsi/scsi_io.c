@@ -77,6 +77,42 @@ bool scsi_write(SCSI* scsi, unsigned long address, unsigned long sectors_count)
 	return res;
 }
 
+bool scsi_synchronize_cache(SCSI* scsi)
+{
+	bool res = false;
+	switch (storage_write_cache(scsi->storage))
+	{
+	case STORAGE_STATUS_OK:
+		res = true;
+		break;
+	case STORAGE_STATUS_NO_MEDIA:
+		scsi_error(scsi, SENSE_KEY_NOT_READY, ASQ_MEDIUM_NOT_PRESENT);
+		break;
+	case STORAGE_STATUS_HARDWARE_FAILURE:
+		scsi_error(scsi, SENSE_KEY_HARDWARE_ERROR, ASQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+		break;
+	case STORAGE_STATUS_DATA_PROTECTED:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_WRITE_PROTECTED);
+		break;
+	case 	STORAGE_STATUS_CRC_ERROR:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_WRITE_ERROR);
+		break;
+	case STORAGE_STATUS_INVALID_ADDRESS:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
+		break;
+	case STORAGE_STATUS_TIMEOUT:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+		break;
+	default:
+		scsi_error(scsi, SENSE_KEY_ABORTED_COMMAND, ASQ_DATA_PHASE_ERROR);
+	}
+#if (SCSI_DEBUG_IO_FAIL)
+	if (!res)
+		printf("SCSI synchronize cache FAIL\n\r");
+#endif //SCSI_DEBUG_FAIL
+	return res;
+}
+
 bool scsi_verify(SCSI* scsi, unsigned long address, unsigned long sectors_count)
 {
 	bool res = false;
@@ -115,3 +151,166 @@ bool scsi_verify(SCSI* scsi, unsigned long address, unsigned long sectors_count)
 #endif //SCSI_DEBUG_FAIL
 	return res;
 }
+
+static inline unsigned long scsi_get_be32(uint8_t* buf)
+{
+	return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | ((uint32_t)buf[3]);
+}
+
+bool scsi_mode_select(SCSI* scsi, unsigned long len, unsigned int header_size)
+{
+	bool res = true;
+	unsigned long pos, page_len;
+	uint8_t* buf;
+	//empty parameter list is not error
+	if (len == 0)
+		return true;
+	if (len < header_size || len > scsi->storage->block_size)
+	{
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_PARAMETER_LIST_LENGTH_ERROR);
+		return false;
+	}
+	buf = (uint8_t*)storage_io_buf_request(scsi->storage, len);
+	//block descriptors are ignored
+	if (header_size == SCSI_MODE_HEADER6_SIZE)
+		pos = header_size + buf[3];
+	else
+		pos = header_size + (((unsigned int)buf[6] << 8) | (unsigned int)buf[7]);
+	for (; res && pos + 2 <= len; pos += page_len)
+	{
+		page_len = buf[pos + 1] + 2;
+		if (pos + page_len > len)
+		{
+			res = false;
+			break;
+		}
+		switch (buf[pos] & 0x3f)
+		{
+		case 0x08:
+			//WCE is only changeable field. Write-through is set after flush, even if flush failed
+			if (page_len > 2 && storage_set_write_cache(scsi->storage, (buf[pos + 2] & SCSI_MODE_PAGE_WCE) ? true : false) != STORAGE_STATUS_OK)
+			{
+				storage_io_buf_release(scsi->storage, (char*)buf);
+				scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_WRITE_ERROR);
+				return false;
+			}
+			break;
+		case 0x1c:
+			break;
+		default:
+#if (SCSI_DEBUG_UNSUPPORTED)
+			printf("SCSI: Mode select: unsupported page 0x%02X\n\r", buf[pos] & 0x3f);
+#endif
+			res = false;
+		}
+	}
+	storage_io_buf_release(scsi->storage, (char*)buf);
+	if (!res)
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_PARAMETER_LIST);
+	return res;
+}
+
+bool scsi_unmap(SCSI* scsi, unsigned long len)
+{
+	bool res = false;
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	unsigned int i, descriptors;
+	unsigned long addr, count;
+	unsigned long discard_addr = 0;
+	unsigned long discard_count = 0;
+	unsigned long max_count;
+	uint8_t* buf;
+	uint8_t* descriptor;
+	//empty parameter list is not error
+	if (len == 0)
+		return true;
+	if (len < SCSI_UNMAP_HEADER_SIZE || len > scsi->storage->block_size)
+	{
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_PARAMETER_LIST_LENGTH_ERROR);
+		return false;
+	}
+	buf = (uint8_t*)storage_io_buf_request(scsi->storage, len);
+	descriptors = (((unsigned int)buf[2] << 8) | (unsigned int)buf[3]) / SCSI_UNMAP_DESCRIPTOR_SIZE;
+	if (descriptors > (len - SCSI_UNMAP_HEADER_SIZE) / SCSI_UNMAP_DESCRIPTOR_SIZE)
+		descriptors = (len - SCSI_UNMAP_HEADER_SIZE) / SCSI_UNMAP_DESCRIPTOR_SIZE;
+	if (descriptors > SCSI_UNMAP_MAX_DESCRIPTORS)
+	{
+		storage_io_buf_release(scsi->storage, (char*)buf);
+		scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_PARAMETER_LIST);
+		return false;
+	}
+	//total count is limited by MAXIMUM UNMAP LBA COUNT of block limits page
+	if (storage_is_media_present(scsi->storage) && storage_get_media_descriptor(scsi->storage)->discard_max_sectors)
+	{
+		max_count = storage_get_media_descriptor(scsi->storage)->discard_max_sectors;
+		for (i = 0; i < descriptors; ++i)
+		{
+			count = scsi_get_be32(buf + SCSI_UNMAP_HEADER_SIZE + i * SCSI_UNMAP_DESCRIPTOR_SIZE + 8);
+			if (count > max_count)
+				break;
+			max_count -= count;
+		}
+		if (i < descriptors)
+		{
+			storage_io_buf_release(scsi->storage, (char*)buf);
+			scsi_error(scsi, SENSE_KEY_ILLEGAL_REQUEST, ASQ_INVALID_FIELD_IN_PARAMETER_LIST);
+			return false;
+		}
+	}
+	//adjacent ranges are merged, so driver can erase them by one command
+	for (i = 0; i < descriptors && status == STORAGE_STATUS_OK; ++i)
+	{
+		descriptor = buf + SCSI_UNMAP_HEADER_SIZE + i * SCSI_UNMAP_DESCRIPTOR_SIZE;
+		//only 32 bit lba is supported
+		if (scsi_get_be32(descriptor))
+		{
+			status = STORAGE_STATUS_INVALID_ADDRESS;
+			break;
+		}
+		addr = scsi_get_be32(descriptor + 4);
+		count = scsi_get_be32(descriptor + 8);
+		if (count == 0)
+			continue;
+		if (discard_count && addr == discard_addr + discard_count)
+			discard_count += count;
+		else
+		{
+			if (discard_count)
+				status = storage_discard(scsi->storage, discard_addr, discard_count);
+			discard_addr = addr;
+			discard_count = count;
+		}
+	}
+	if (status == STORAGE_STATUS_OK && discard_count)
+		status = storage_discard(scsi->storage, discard_addr, discard_count);
+	storage_io_buf_release(scsi->storage, (char*)buf);
+
+	switch (status)
+	{
+	case STORAGE_STATUS_OK:
+		res = true;
+		break;
+	case STORAGE_STATUS_NO_MEDIA:
+		scsi_error(scsi, SENSE_KEY_NOT_READY, ASQ_MEDIUM_NOT_PRESENT);
+		break;
+	case STORAGE_STATUS_HARDWARE_FAILURE:
+		scsi_error(scsi, SENSE_KEY_HARDWARE_ERROR, ASQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+		break;
+	case STORAGE_STATUS_DATA_PROTECTED:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_WRITE_PROTECTED);
+		break;
+	case STORAGE_STATUS_INVALID_ADDRESS:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
+		break;
+	case STORAGE_STATUS_TIMEOUT:
+		scsi_error(scsi, SENSE_KEY_MEDIUM_ERROR, ASQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+		break;
+	default:
+		scsi_error(scsi, SENSE_KEY_ABORTED_COMMAND, ASQ_DATA_PHASE_ERROR);
+	}
+#if (SCSI_DEBUG_IO_FAIL)
+	if (!res)
+		printf("SCSI unmap %d descriptor(s) FAIL\n\r", descriptors);
+#endif //SCSI_DEBUG_FAIL
+	return res;
+}
@@ -7,6 +7,9 @@
 bool scsi_read(SCSI* scsi, unsigned long address, unsigned long sectors_count);
 bool scsi_write(SCSI* scsi, unsigned long address, unsigned long sectors_count);
 bool scsi_verify(SCSI* scsi, unsigned long address, unsigned long sectors_count);
+bool scsi_synchronize_cache(SCSI* scsi);
+bool scsi_mode_select(SCSI* scsi, unsigned long len, unsigned int header_size);
+bool scsi_unmap(SCSI* scsi, unsigned long len);
 
 
 #endif // SCSI_IO_H
@@ -45,6 +45,36 @@ void scsi_fill_capacity_page(SCSI* scsi)
 	storage_io_buf_filled(scsi->storage, buf, len);
 }
 
+void scsi_fill_capacity16_page(SCSI* scsi)
+{
+	char* buf = storage_io_buf_allocate(scsi->storage);
+	int len = 32;
+	memset(buf, 0, len);
+
+	uint32_t max_sector = 0;
+	uint32_t sector_size = 0;
+	if (storage_is_media_present(scsi->storage))
+	{
+		max_sector = storage_get_media_descriptor(scsi->storage)->num_sectors - 1;
+		sector_size = storage_get_device_descriptor(scsi->storage)->sector_size;
+	}
+	//64 bit address, high part is always 0
+	buf[4] = (char)(max_sector >> 24);
+	buf[5] = (char)(max_sector >> 16);
+	buf[6] = (char)(max_sector >> 8);
+	buf[7] = (char)(max_sector);
+
+	buf[8] = (char)(sector_size >> 24);
+	buf[9] = (char)(sector_size >> 16);
+	buf[10] = (char)(sector_size >> 8);
+	buf[11] = (char)(sector_size);
+	//LBPME: logical block provisioning (UNMAP) enabled
+	if (storage_is_discard_supported(scsi->storage))
+		buf[14] = 0x80;
+
+	storage_io_buf_filled(scsi->storage, buf, len);
+}
+
 void scsi_fill_format_capacity_page(SCSI* scsi)
 {
 	char* buf = storage_io_buf_allocate(scsi->storage);
@@ -104,14 +134,19 @@ void scsi_fill_evpd_page_00(SCSI* scsi)
 {
 	char* buf = storage_io_buf_allocate(scsi->storage);
 	int len = 7;
-	memset(buf, 0, len);
+	memset(buf, 0, 9);
 
 	buf[0] = (char)scsi->descriptor->scsi_device_type;
 	buf[1] = 0x00; //page address
-	buf[3] = len - 4;
 	buf[4] = INQUIRY_VITAL_PAGE_SUPPORTED_PAGES;
 	buf[5] = INQUIRY_VITAL_PAGE_DEVICE_INFO;
 	buf[6] = INQUIRY_VITAL_PAGE_SERIAL_NUM;
+	if (storage_is_discard_supported(scsi->storage))
+	{
+		buf[len++] = INQUIRY_VITAL_PAGE_BLOCK_LIMITS;
+		buf[len++] = INQUIRY_VITAL_PAGE_LOGICAL_BLOCK_PROVISIONING;
+	}
+	buf[3] = len - 4;
 
 	storage_io_buf_filled(scsi->storage, buf, len);
 }
@@ -151,17 +186,112 @@ void scsi_fill_evpd_page_83(SCSI* scsi)
 	storage_io_buf_filled(scsi->storage, buf, len);
 }
 
-void scsi_fill_sense_page_1c(SCSI* scsi)
+void scsi_fill_evpd_page_b0(SCSI* scsi)
+{
+	char* buf = storage_io_buf_allocate(scsi->storage);
+	int len = 64;
+	uint32_t max_sectors = 0;
+	uint32_t granularity = 0;
+	memset(buf, 0, len);
+
+	buf[0] = (char)scsi->descriptor->scsi_device_type;
+	buf[1] = 0xb0; //page address
+	buf[3] = len - 4;
+	if (storage_is_media_present(scsi->storage))
+	{
+		max_sectors = storage_get_media_descriptor(scsi->storage)->discard_max_sectors;
+		granularity = storage_get_media_descriptor(scsi->storage)->discard_granularity;
+	}
+	//maximum unmap lba count, 0xffffffff - unlimited
+	if (max_sectors == 0)
+		max_sectors = 0xffffffff;
+	buf[20] = (char)(max_sectors >> 24);
+	buf[21] = (char)(max_sectors >> 16);
+	buf[22] = (char)(max_sectors >> 8);
+	buf[23] = (char)(max_sectors);
+	//maximum unmap block descriptor count
+	buf[27] = SCSI_UNMAP_MAX_DESCRIPTORS;
+	//optimal unmap granularity, aligned to lba 0
+	if (granularity)
+	{
+		buf[28] = (char)(granularity >> 24);
+		buf[29] = (char)(granularity >> 16);
+		buf[30] = (char)(granularity >> 8);
+		buf[31] = (char)(granularity);
+		buf[32] = 0x80;
+	}
+
+	storage_io_buf_filled(scsi->storage, buf, len);
+}
+
+void scsi_fill_evpd_page_b2(SCSI* scsi)
 {
 	char* buf = storage_io_buf_allocate(scsi->storage);
 	int len = 8;
 	memset(buf, 0, len);
+
+	buf[0] = (char)scsi->descriptor->scsi_device_type;
+	buf[1] = 0xb2; //page address
+	buf[3] = len - 4;
+	buf[5] = 0x80;					//LBPU: UNMAP supported
+	buf[6] = 0x01;					//resource provisioned: media capacity is not changed by unmap
+
+	storage_io_buf_filled(scsi->storage, buf, len);
+}
+
+//page control: 0 - current, 1 - changeable, 2 - default, 3 - saved
+static inline unsigned int scsi_mode_sense_pc(SCSI* scsi)
+{
+	return (scsi->cmd.cmd_type == SCSI_CMD_6 ? scsi->cmd.address >> 14 : scsi->cmd.address >> 30) & 3;
+}
+
+static int scsi_put_sense_page_08(SCSI* scsi, char* buf)
+{
+	int len = 20;
+	memset(buf, 0, len);
+	buf[0] = 0x08;
+	buf[1] = len - 2;
+	switch (scsi_mode_sense_pc(scsi))
+	{
+	//current
+	case 0:
+		//WCE: writes are completed from write-back cache
+		if (storage_is_write_cache_enabled(scsi->storage))
+			buf[2] = SCSI_MODE_PAGE_WCE;
+		break;
+	//changeable, default, saved: WCE can be changed by MODE SELECT, if cache is present
+	default:
+		if (storage_is_cache_present(scsi->storage))
+			buf[2] = SCSI_MODE_PAGE_WCE;
+	}
+	return len;
+}
+
+static int scsi_put_sense_page_1c(SCSI* scsi, char* buf)
+{
+	int len = 8;
+	memset(buf, 0, len);
 	buf[0] = 0x1c;
 	buf[1] = len -2;
-	storage_io_buf_filled(scsi->storage, buf, len);
+	return len;
+}
+
+void scsi_fill_sense_page_08(SCSI* scsi)
+{
+	char* buf = storage_io_buf_allocate(scsi->storage);
+	storage_io_buf_filled(scsi->storage, buf, scsi_put_sense_page_08(scsi, buf));
+}
+
+void scsi_fill_sense_page_1c(SCSI* scsi)
+{
+	char* buf = storage_io_buf_allocate(scsi->storage);
+	storage_io_buf_filled(scsi->storage, buf, scsi_put_sense_page_1c(scsi, buf));
 }
 
 void scsi_fill_sense_page_3f(SCSI* scsi)
 {
-	scsi_fill_sense_page_1c(scsi);
+	char* buf = storage_io_buf_allocate(scsi->storage);
+	int len = scsi_put_sense_page_08(scsi, buf);
+	len += scsi_put_sense_page_1c(scsi, buf + len);
+	storage_io_buf_filled(scsi->storage, buf, len);
 }
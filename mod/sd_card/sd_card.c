@@ -16,6 +16,7 @@ static const SDIO_CB _sdio_cb = {
 	sd_card_on_error
 };
 
+//not pipelined: block is not queued, while previous one is transferring
 static const  STORAGE_DEVICE_DESCRIPTOR _storage_device_descriptor = {
 	STORAGE_DEVICE_FLAG_REMOVABLE,
 	SD_CARD_SECTOR_SIZE
@@ -23,21 +24,19 @@ static const  STORAGE_DEVICE_DESCRIPTOR _storage_device_descriptor = {
 
 static const STORAGE_DRIVER_CB _storage_cb = {
 	sd_card_check_media,
-	//on_cancel_io
-	NULL,
+	sd_card_cancel_io,
 	//on_storage_prepare_read
 	NULL,
 	sd_card_read_blocks,
 	//on_storage_read_done
 	NULL,
-	//on_storage_prepare_read
-	NULL,
+	sd_card_prepare_write,
 	sd_card_write_blocks,
-	//on_storage_write_done
-	NULL,
+	sd_card_write_done,
 	//on_write_cache
 	NULL,
-	sd_card_stop
+	sd_card_stop,
+	sd_card_discard
 };
 
 SD_CARD* sd_card_create(SDIO_CLASS port, int priority)
@@ -49,6 +48,9 @@ SD_CARD* sd_card_create(SDIO_CLASS port, int priority)
 		sd_card->data_event = event_create();
 
 		sd_card->card_present = false;
+		sd_card->write_stream = false;
+		memset(&sd_card->stats, 0, sizeof(SD_CARD_STATS));
+		sd_card->registers_valid = sd_card->fast_mount = false;
 		sd_card->port = port;
 		sdio_enable(port, (P_SDIO_CB)&_sdio_cb, sd_card, priority);
 
@@ -79,3 +81,32 @@ STORAGE* sd_card_get_storage(SD_CARD *sd_card)
 {
 	return sd_card->storage;
 }
+
+void sd_card_get_stats(SD_CARD* sd_card, SD_CARD_STATS* stats)
+{
+	memcpy(stats, &sd_card->stats, sizeof(SD_CARD_STATS));
+}
+
+void sd_card_reset_stats(SD_CARD* sd_card)
+{
+	memset(&sd_card->stats, 0, sizeof(SD_CARD_STATS));
+}
+
+void sd_card_stat(SD_CARD* sd_card)
+{
+	SD_CARD_STATS stats;
+	unsigned int i;
+	const char* const mount_phase_names[SD_CARD_MOUNT_PHASES] = {"power", "identify", "bus"};
+	sd_card_get_stats(sd_card, &stats);
+	printf("busy after write: %d times, avg %d us, max %d us\n\r", stats.busy_count,
+			 stats.busy_count ? (unsigned long)(stats.busy_total_us / stats.busy_count) : 0, stats.busy_max_us);
+	printf("mounts: %d, fast: %d, last:", stats.mounts, stats.fast_mounts);
+	for (i = 0; i < SD_CARD_MOUNT_PHASES; ++i)
+		printf(" %s %d us", mount_phase_names[i], stats.mount_us[i]);
+	printf("\n\r");
+	//bucket N is 2^N us
+	printf("busy    ");
+	for (i = 0; i < SD_CARD_HISTOGRAM_SIZE; ++i)
+		printf(" %d", stats.busy[i]);
+	printf("\n\r");
+}
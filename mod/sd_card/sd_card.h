@@ -7,6 +7,17 @@
 #include "sdio.h"
 #include "scsi.h"
 
+typedef struct {
+	//card was busy after write
+	unsigned long busy_count;
+	unsigned long long busy_total_us;
+	unsigned int busy_max_us;
+	unsigned long busy[SD_CARD_HISTOGRAM_SIZE];
+	unsigned long mounts, fast_mounts;
+	//last mount breakdown
+	unsigned int mount_us[SD_CARD_MOUNT_PHASES];
+}SD_CARD_STATS;
+
 typedef struct {
 	//first field will be aligned 4
 	uint32_t sdio_cmd_response[4];
@@ -18,16 +29,32 @@ typedef struct {
 	bool writing;
 	STORAGE_MEDIA_DESCRIPTOR media;
 	bool card_present;
+	//CCC class 5, minimal erase range in sectors
+	bool erase_supported;
+	unsigned long erase_unit;
+	//CMD25 is open between storage blocks, until write_done. write_end is pre-erase range
+	bool write_stream;
+	unsigned long write_next, write_end;
+	SD_CARD_STATS stats;
 	HANDLE data_event;
 	//raw response data
 	//card registers
 	SDIO_CARD_TYPE card_type;
 	uint16_t rca;
+	//registers of last mounted card. Same card by CID is mounted without CSD, SCR and CMD6 status read
+	uint32_t cid[4];
+	uint8_t scr[8];
+	bool high_speed;
+	bool registers_valid, fast_mount;
 }SD_CARD;
 
 SD_CARD* sd_card_create(SDIO_CLASS port, int priority);
 void sd_card_destroy(SD_CARD* sd_card);
 
 STORAGE* sd_card_get_storage(SD_CARD* sd_card);
+void sd_card_get_stats(SD_CARD* sd_card, SD_CARD_STATS* stats);
+void sd_card_reset_stats(SD_CARD* sd_card);
+//print to debug console
+void sd_card_stat(SD_CARD* sd_card);
 
 #endif // SD_CARD_H
@@ -6,6 +6,9 @@
 #include "kernel_config.h"
 #include "gpio.h"
 #include "delay.h"
+#include "thread.h"
+#include "sys_time.h"
+#include <string.h>
 
 #if (SD_CARD_DEBUG_ERRORS)
 void dbg_r1_error(SD_CARD* sd_card, uint8_t cmd)
@@ -127,15 +130,39 @@ bool sd_card_app_cmd(SD_CARD* sd_card, uint8_t cmd, uint32_t arg, SDIO_RESPONSE_
 	return res;
 }
 
+//sleep between polls, so other threads are running, while card is programming
+static inline unsigned int sd_card_busy_sleep(unsigned int poll_us)
+{
+	sleep_us(poll_us);
+	poll_us <<= 1;
+	return poll_us > SD_CARD_BUSY_POLL_MAX_US ? SD_CARD_BUSY_POLL_MAX_US : poll_us;
+}
+
+static inline void sd_card_busy_stat(SD_CARD* sd_card, TIME* from)
+{
+	unsigned int us = time_elapsed_us(from);
+	unsigned int i;
+	++sd_card->stats.busy_count;
+	sd_card->stats.busy_total_us += us;
+	if (us > sd_card->stats.busy_max_us)
+		sd_card->stats.busy_max_us = us;
+	for (i = 0; us > 1 && i < SD_CARD_HISTOGRAM_SIZE - 1; ++i)
+		us >>= 1;
+	++sd_card->stats.busy[i];
+}
+
 static inline bool sd_card_wait_for_ready(SD_CARD* sd_card)
 {
 	bool res = false;
+	unsigned int poll_us = SD_CARD_BUSY_POLL_MIN_US;
 	while (!res)
 	{
 		if (sd_card_r1_cmd(sd_card, SDIO_SEND_STATUS, (uint32_t)sd_card->rca << 16ul))
 		{
 			if (sd_card->sdio_cmd_response[0] & (1 << 8ul))
 				res = true;
+			else
+				poll_us = sd_card_busy_sleep(poll_us);
 		}
 		else
 			break;
@@ -143,25 +170,35 @@ static inline bool sd_card_wait_for_ready(SD_CARD* sd_card)
 	return res;
 }
 
-static inline bool sd_card_wait_for_data_transferred(SD_CARD* sd_card)
+//programming - card is busy after write, count busy time
+static inline bool sd_card_wait_for_tran(SD_CARD* sd_card, bool programming)
 {
-	//recovery, based on TOSHIBA recomendations
-	int retries = 1000 * 10;
-	while (retries--)
-	{
+	TIME start;
+	bool busy = false;
+	unsigned int poll_us = SD_CARD_BUSY_POLL_MIN_US;
+	get_uptime(&start);
+	do {
 		if ((sd_card_r1_cmd(sd_card, SDIO_SEND_STATUS, (uint32_t)sd_card->rca << 16ul)))
 		{
 			if (((sd_card->sdio_cmd_response[0] >> 9) & 0xf) == SD_CARD_STATE_TRAN)
 			{
 				sd_card->status = STORAGE_STATUS_OK;
+				if (busy && programming)
+					sd_card_busy_stat(sd_card, &start);
 				return true;
 			}
 		}
-		delay_us(100);
-	}
+		busy = true;
+		poll_us = sd_card_busy_sleep(poll_us);
+	} while (time_elapsed_us(&start) < SD_CARD_BUSY_TIMEOUT_US);
 	return false;
 }
 
+static inline bool sd_card_wait_for_data_transferred(SD_CARD* sd_card)
+{
+	return sd_card_wait_for_tran(sd_card, false);
+}
+
 static inline bool sd_card_check_power_conditions(SD_CARD* sd_card)
 {
 	bool res = false;
@@ -217,6 +254,9 @@ static inline bool sd_card_read_cid(SD_CARD* sd_card)
 		//MID + MDT + PSN
 		sprintf(sd_card->media.serial_number, "%02X%02X%06X%02X", sd_card->sdio_cmd_response[0] >> 24,
 				  (sd_card->sdio_cmd_response[3] >> 16) & 0xff, sd_card->sdio_cmd_response[2] >> 8, sd_card->sdio_cmd_response[3] >> 24);
+		//same card is reinserted, or reset: media descriptor, erase params and SCR are still valid
+		sd_card->fast_mount = sd_card->registers_valid && memcmp(sd_card->cid, sd_card->sdio_cmd_response, sizeof(sd_card->cid)) == 0;
+		memcpy(sd_card->cid, sd_card->sdio_cmd_response, sizeof(sd_card->cid));
 #if (SD_CARD_DEBUG_FLOW)
 		printf("SD_CARD CID.MID: %#.2x\n\r", sd_card->sdio_cmd_response[0] >> 24);
 		printf("SD_CARD CID.OID: %c%c\n\r", (char)(sd_card->sdio_cmd_response[0] >> 16), (char)(sd_card->sdio_cmd_response[0] >> 8));
@@ -273,6 +313,18 @@ static inline bool sd_card_read_csd(SD_CARD* sd_card)
 					uint32_t c_size = ((sd_card->sdio_cmd_response[1] & 0x3fful) << 2ul) | (sd_card->sdio_cmd_response[2] >> 30ul);
 					sd_card->media.num_sectors = (c_size + 1) * mult;
 				}
+				//CCC class 5: erase commands
+				sd_card->erase_supported = (sd_card->sdio_cmd_response[1] >> 20ul) & (1ul << 5ul);
+				//ERASE_BLK_EN: erase by write blocks, else by SECTOR_SIZE blocks. Both are fixed for csd v2
+				if ((sd_card->sdio_cmd_response[2] >> 14ul) & 1ul)
+					sd_card->erase_unit = 1;
+				else
+					sd_card->erase_unit = ((sd_card->sdio_cmd_response[2] >> 7ul) & 0x7ful) + 1;
+				//whole erase units, fitting in card busy timeout
+				sd_card->media.discard_granularity = sd_card->erase_unit;
+				sd_card->media.discard_max_sectors = SD_CARD_ERASE_MAX_SECTORS - SD_CARD_ERASE_MAX_SECTORS % sd_card->erase_unit;
+				if (sd_card->media.discard_max_sectors < sd_card->erase_unit)
+					sd_card->media.discard_max_sectors = sd_card->erase_unit;
 				sd_card->media.flags = 0;
 				if ((sd_card->sdio_cmd_response[3] >> 12) & 3ul)
 					sd_card->media.flags |= STORAGE_MEDIA_FLAG_WRITE_PROTECTION;
@@ -288,7 +340,7 @@ static inline bool sd_card_get_registers(SD_CARD* sd_card)
 	bool res = false;
 	if (sd_card_read_cid(sd_card))
 		if (sd_card_read_rca(sd_card))
-			if (sd_card_read_csd(sd_card))
+			if (sd_card->fast_mount || sd_card_read_csd(sd_card))
 				res = true;
 	return res;
 }
@@ -349,45 +401,70 @@ static inline bool sd_card_switch(SD_CARD* sd_card, uint32_t cmd)
 bool sd_card_setup_bus(SD_CARD* sd_card)
 {
 	bool res = false;
-	if (sd_card_read_scr(sd_card))
+	if (sd_card->fast_mount)
+		res = true;
+	else if (sd_card_read_scr(sd_card))
 	{
+		memcpy(sd_card->scr, sd_card->cmd_buf, sizeof(sd_card->scr));
+		sd_card->high_speed = false;
 		res = true;
+	}
+	if (res)
+	{
 		//bus width 4 bit support bit
-		if (sd_card->cmd_buf[1] & 4)
+		if (sd_card->scr[1] & 4)
 			if (sd_card_app_cmd(sd_card, SDIO_APP_SET_BUS_WIDTH, 0x2, SDIO_RESPONSE_R1))
 			{
-				delay_ms(100);
+				//settle delay is only for unknown card
+				if (!sd_card->fast_mount)
+					delay_ms(100);
 				sdio_setup_bus(sd_card->port, 25000000, SDIO_BUS_WIDE_4B);
 			}
-		//check for CMD6 support
-		if (sd_card->cmd_buf[0] & 0xf)
+		//check for CMD6 support. Known card is switched without function status check
+		if (!sd_card->fast_mount && (sd_card->scr[0] & 0xf))
 			if (sd_card_switch(sd_card, SDIO_SWITCH_HIGH_SPEED_CHECK))
 				if (sd_card->cmd_buf[0xc] & 0x80)
-				{
+					sd_card->high_speed = true;
+		if (sd_card->high_speed)
+		{
 #if (SD_CARD_DEBUG)
-					printf("SD_CARD: HIGH SPEED mode supported\n\r");
+			printf("SD_CARD: HIGH SPEED mode supported\n\r");
 #endif
-					sd_card_switch(sd_card, SDIO_SWITCH_CURRENT_400);
-					sd_card_switch(sd_card, SDIO_SWITCH_STRENGTH_A);
-					sd_card_switch(sd_card, SDIO_SWITCH_COMMAND_EC);
-					sd_card_switch(sd_card, SDIO_SWITCH_HIGH_SPEED);
-					sdio_setup_bus(sd_card->port, 50000000, SDIO_BUS_WIDE_4B);
-				}
+			sd_card_switch(sd_card, SDIO_SWITCH_CURRENT_400);
+			sd_card_switch(sd_card, SDIO_SWITCH_STRENGTH_A);
+			sd_card_switch(sd_card, SDIO_SWITCH_COMMAND_EC);
+			sd_card_switch(sd_card, SDIO_SWITCH_HIGH_SPEED);
+			sdio_setup_bus(sd_card->port, 50000000, SDIO_BUS_WIDE_4B);
+		}
 	}
-	delay_ms(100);
+	if (!sd_card->fast_mount)
+		delay_ms(100);
 	return res;
 }
 
+static inline void sd_card_mount_phase(SD_CARD* sd_card, SD_CARD_MOUNT_PHASE phase, TIME* start)
+{
+	sd_card->stats.mount_us[phase] = time_elapsed_us(start);
+	get_uptime(start);
+}
+
 static inline bool sd_card_validate(SD_CARD* sd_card)
 {
 	bool res = false;
+	TIME start;
+	memset(sd_card->stats.mount_us, 0, sizeof(sd_card->stats.mount_us));
+	get_uptime(&start);
+	sd_card->fast_mount = false;
 	sd_card->rca = 0;
 	sdio_power_on(sd_card->port);
 	sdio_setup_bus(sd_card->port, 400000, SDIO_BUS_WIDE_1B);
 
 	if (sd_card_check_power_conditions(sd_card))
+	{
+		sd_card_mount_phase(sd_card, SD_CARD_MOUNT_POWER, &start);
 		if (sd_card_get_registers(sd_card))
 		{
+			sd_card_mount_phase(sd_card, SD_CARD_MOUNT_IDENTIFY, &start);
 			//at this point we are ready to faster speed to 25MHz
 			sdio_setup_bus(sd_card->port, 25000000, SDIO_BUS_WIDE_1B);
 			if (sd_card_select(sd_card))
@@ -396,10 +473,23 @@ static inline bool sd_card_validate(SD_CARD* sd_card)
 					//SDSC requires block len
 					if (sd_card_wait_for_ready(sd_card))
 						res = sd_card_r1_cmd(sd_card, SDIO_SET_BLOCKLEN, SD_CARD_SECTOR_SIZE);
+					sd_card_mount_phase(sd_card, SD_CARD_MOUNT_BUS, &start);
 				}
 		}
-	if (!res)
+	}
+	if (res)
+	{
+		++sd_card->stats.mounts;
+		if (sd_card->fast_mount)
+			++sd_card->stats.fast_mounts;
+		sd_card->registers_valid = true;
+	}
+	else
+	{
+		//don't trust cached registers after failure
+		sd_card->registers_valid = false;
 		sdio_power_off(sd_card->port);
+	}
 	return res;
 }
 
@@ -437,6 +527,7 @@ bool sd_card_check_media(void* param)
 	{
 		sdio_power_off(sd_card->port);
 		sd_card->card_present = false;
+		sd_card->write_stream = false;
 		storage_eject_media(sd_card->storage);
 	}
 #endif
@@ -452,6 +543,7 @@ void sd_card_stop(void* param)
 			sd_card_cmd(sd_card, SDIO_GO_INACTIVE_STATE, (uint32_t)sd_card->rca << 16ul, SDIO_NO_RESPONSE);
 		sd_card->rca = 0;
 		sd_card->card_present = false;
+		sd_card->write_stream = false;
 		sdio_power_off(sd_card->port);
 	}
 }
@@ -474,7 +566,7 @@ void sd_card_on_write_complete(SDIO_CLASS port, void* param)
 	SD_CARD* sd_card = (SD_CARD*)param;
 	if (sd_card->card_present)
 	{
-		sd_card_r1_cmd(sd_card, SDIO_STOP_TRANSMISSION, 0x0);
+		//CMD25 is kept open for next storage block, write_done or stream break will stop it
 		storage_blocks_writed(sd_card->storage, sd_card->status);
 	}
 }
@@ -483,6 +575,7 @@ void sd_card_on_error(SDIO_CLASS port, void* param, SDIO_ERROR error)
 {
 	SD_CARD* sd_card = (SD_CARD*)param;
 	sd_card_r1_cmd(sd_card, SDIO_STOP_TRANSMISSION, 0x0);
+	sd_card->write_stream = false;
 	if (sd_card->card_present)
 	{
 		switch(error)
@@ -530,24 +623,136 @@ STORAGE_STATUS sd_card_read_blocks(void* param, unsigned long addr, char* buf, u
 	return sd_card->status;
 }
 
+static inline void sd_card_write_stream_stop(SD_CARD* sd_card)
+{
+	if (sd_card->write_stream)
+	{
+		sd_card->write_stream = false;
+		sd_card_r1_cmd(sd_card, SDIO_STOP_TRANSMISSION, 0x0);
+		//busy time of this write, not of the next command
+		if (!sd_card_wait_for_tran(sd_card, true))
+			sd_card->status = STORAGE_STATUS_TIMEOUT;
+	}
+}
+
+STORAGE_STATUS sd_card_prepare_write(void* param, unsigned long addr, unsigned long count)
+{
+	SD_CARD* sd_card = (SD_CARD*)param;
+	sd_card->status = STORAGE_STATUS_OK;
+	sd_card_write_stream_stop(sd_card);
+	sd_card->write_next = addr;
+	sd_card->write_end = addr + count;
+	return sd_card->status;
+}
+
 STORAGE_STATUS sd_card_write_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count)
 {
 	SD_CARD* sd_card = (SD_CARD*)param;
+	unsigned long card_addr = addr;
 	sd_card->status = STORAGE_STATUS_OK;
 	sd_card->writing = true;
 	if (sd_card_check_media(sd_card))
 	{
-		if (sd_card_wait_for_data_transferred(sd_card))
+		//stream break: out of prepared range, or not sequential
+		if (sd_card->write_stream && addr != sd_card->write_next)
+			sd_card_write_stream_stop(sd_card);
+		if (!sd_card->write_stream)
 		{
-			//SDSC cards operates in absolute addr units
-			if (sd_card->card_type == SDSC_V1 || sd_card->card_type == SDSC_V2)
-				addr = addr * SD_CARD_SECTOR_SIZE;
+			if (sd_card_wait_for_data_transferred(sd_card))
+			{
+				if (addr + blocks_count > sd_card->write_end)
+					sd_card->write_end = addr + blocks_count;
+				//pre-erase for whole rest of host range. Optional, so failure is ignored
+				sd_card_app_cmd(sd_card, SDIO_APP_SET_WR_BLK_ERASE_COUNT, (sd_card->write_end - addr) & 0x7ffffful, SDIO_RESPONSE_R1);
+				sd_card->status = STORAGE_STATUS_OK;
+				//SDSC cards operates in absolute addr units
+				if (sd_card->card_type == SDSC_V1 || sd_card->card_type == SDSC_V2)
+					card_addr = addr * SD_CARD_SECTOR_SIZE;
+				if (sd_card_r1_cmd(sd_card, SDIO_WRITE_MULTIPLE_BLOCK, card_addr))
+					sd_card->write_stream = true;
+			}
+			else
+			{
+				storage_blocks_writed(sd_card->storage, sd_card->status);
+				return sd_card->status;
+			}
+		}
+		if (sd_card->write_stream)
+		{
+			sd_card->write_next = addr + blocks_count;
+			sdio_write(sd_card->port, buf, SD_CARD_SECTOR_SIZE, blocks_count);
+		}
+	}
+	else
+		sd_card->status = STORAGE_STATUS_NO_MEDIA;
+	return sd_card->status;
+}
+
+STORAGE_STATUS sd_card_write_done(void* param)
+{
+	SD_CARD* sd_card = (SD_CARD*)param;
+	sd_card->status = STORAGE_STATUS_OK;
+	sd_card_write_stream_stop(sd_card);
+	return sd_card->status;
+}
+
+void sd_card_cancel_io(void* param)
+{
+	SD_CARD* sd_card = (SD_CARD*)param;
+	sd_card_write_stream_stop(sd_card);
+}
 
-			if (sd_card_r1_cmd(sd_card, SDIO_WRITE_MULTIPLE_BLOCK, addr))
-				sdio_write(sd_card->port, buf, SD_CARD_SECTOR_SIZE, blocks_count);
+static inline bool sd_card_erase(SD_CARD* sd_card, unsigned long addr, unsigned long count)
+{
+	unsigned long last = addr + count - 1;
+	if (!sd_card_wait_for_data_transferred(sd_card))
+	{
+		sd_card->status = STORAGE_STATUS_TIMEOUT;
+		return false;
+	}
+	//SDSC cards operates in absolute addr units
+	if (sd_card->card_type == SDSC_V1 || sd_card->card_type == SDSC_V2)
+	{
+		addr = addr * SD_CARD_SECTOR_SIZE;
+		last = last * SD_CARD_SECTOR_SIZE;
+	}
+	if (sd_card_r1_cmd(sd_card, SDIO_ERASE_WR_BLK_START_ADDR, addr) && sd_card_r1_cmd(sd_card, SDIO_ERASE_WR_BLK_END_ADDR, last) &&
+		 sd_card_cmd(sd_card, SDIO_ERASE, 0x0, SDIO_RESPONSE_R1B))
+	{
+		//card is in programming state, until erase is complete
+		if (sd_card_wait_for_data_transferred(sd_card))
+			return true;
+		sd_card->status = STORAGE_STATUS_TIMEOUT;
+	}
+	return false;
+}
+
+STORAGE_STATUS sd_card_discard(void* param, unsigned long addr, unsigned long count)
+{
+	SD_CARD* sd_card = (SD_CARD*)param;
+	unsigned long first, last, cur;
+	sd_card->status = STORAGE_STATUS_OK;
+	if (sd_card_check_media(param))
+	{
+		//discard is only hint for card FTL, partially covered erase units are left as is
+		if (!sd_card->erase_supported)
+			return STORAGE_STATUS_OK;
+		first = (addr + sd_card->erase_unit - 1) / sd_card->erase_unit * sd_card->erase_unit;
+		last = (addr + count) / sd_card->erase_unit * sd_card->erase_unit;
+		//range is erased by batches, each one is completed in card busy timeout
+		while (first < last)
+		{
+			cur = last - first;
+			if (cur > sd_card->media.discard_max_sectors)
+				cur = sd_card->media.discard_max_sectors;
+			if (!sd_card_erase(sd_card, first, cur))
+				break;
+			first += cur;
 		}
-		else
-			storage_blocks_writed(sd_card->storage, sd_card->status);
+#if (SD_CARD_DEBUG_ERRORS)
+		if (sd_card->status != STORAGE_STATUS_OK)
+			printf("SD_CARD: erase %d sector(s) at %d failed\n\r", count, addr);
+#endif
 	}
 	else
 		sd_card->status = STORAGE_STATUS_NO_MEDIA;
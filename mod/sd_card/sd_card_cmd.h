@@ -8,7 +8,11 @@
 bool sd_card_check_media(void* param);
 void sd_card_stop(void* param);
 STORAGE_STATUS sd_card_read_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count);
+STORAGE_STATUS sd_card_prepare_write(void* param, unsigned long addr, unsigned long count);
 STORAGE_STATUS sd_card_write_blocks(void* param, unsigned long addr, char* buf, unsigned long blocks_count);
+STORAGE_STATUS sd_card_write_done(void* param);
+void sd_card_cancel_io(void* param);
+STORAGE_STATUS sd_card_discard(void* param, unsigned long addr, unsigned long count);
 
 void sd_card_on_read_complete(SDIO_CLASS port, void* param);
 void sd_card_on_write_complete(SDIO_CLASS port, void* param);
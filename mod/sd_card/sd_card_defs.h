@@ -3,6 +3,14 @@
 
 #define SD_CARD_SECTOR_SIZE								512
 
+//busy card status poll. Interval is doubled after each poll up to max
+#define SD_CARD_BUSY_POLL_MIN_US							20
+#define SD_CARD_BUSY_POLL_MAX_US							1000
+//recovery, based on TOSHIBA recomendations
+#define SD_CARD_BUSY_TIMEOUT_US							1000000
+//log2 scale in us: bucket N is [2^N, 2^(N+1)), last is everything above
+#define SD_CARD_HISTOGRAM_SIZE							20
+
 //general sdio commands
 #define SDIO_GO_IDLE_STATE									0
 #define SDIO_SEND_OP_COND									1
@@ -70,6 +78,16 @@
 #define SDIO_SWITCH_STRENGTH_A							0x80fff1ff
 #define SDIO_SWITCH_CURRENT_400							0x80ff1fff
 
+typedef enum {
+	//power up, voltage and capacity negotiation
+	SD_CARD_MOUNT_POWER = 0,
+	//CID, RCA, CSD
+	SD_CARD_MOUNT_IDENTIFY,
+	//select, SCR, bus width, high speed switch
+	SD_CARD_MOUNT_BUS,
+	SD_CARD_MOUNT_PHASES
+} SD_CARD_MOUNT_PHASE;
+
 typedef enum {
 	SDSC_V1,
 	SDSC_V2,
@@ -1,12 +1,742 @@
 #include "storage.h"
 #include <string.h>
 #include "mem_private.h"
+#include "mem.h"
 #include "error.h"
 #include "event.h"
 #include "dbg.h"
 #include "queue.h"
+#include "sem.h"
+#include "sys_time.h"
+#include "printf.h"
 #include "kernel_config.h"
 
+#define STORAGE_NO_STREAM									((unsigned long)-1)
+
+#if (STORAGE_IO_STATS)
+#define STORAGE_STATS_ADD(storage, field, value)		((storage)->stats.field += (value))
+#define STORAGE_STATS_START(storage)						get_uptime(&(storage)->stats_time)
+#define STORAGE_STATS_PHASE(storage, phase)				storage_stats_latency((storage), (phase), &(storage)->stats_time)
+
+static void storage_stats_latency(STORAGE* storage, STORAGE_PHASE phase, TIME* from)
+{
+	unsigned int us = time_elapsed_us(from);
+	unsigned int i;
+	for (i = 0; us > 1 && i < STORAGE_HISTOGRAM_SIZE - 1; ++i)
+		us >>= 1;
+	++storage->stats.latency[phase][i];
+}
+
+static void storage_stats_op(STORAGE* storage, STORAGE_DIR_STATS* dir, unsigned long count, STORAGE_STATUS status)
+{
+	++dir->ops;
+	if (status == STORAGE_STATUS_OK)
+	{
+		dir->sectors += count;
+		dir->bytes += (unsigned long long)count * storage->device_descriptor->sector_size;
+	}
+	if (status < STORAGE_STATUS_COUNT)
+		++storage->stats.results[status];
+}
+#else
+#define STORAGE_STATS_ADD(storage, field, value)
+#define STORAGE_STATS_START(storage)
+#define STORAGE_STATS_PHASE(storage, phase)
+#endif //STORAGE_IO_STATS
+
+static STORAGE_STATUS storage_driver_prepare_read(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	if (storage->driver_cb->on_storage_prepare_read)
+	{
+		STORAGE_STATS_START(storage);
+		status = storage->driver_cb->on_storage_prepare_read(storage->driver_param, addr, count);
+		STORAGE_STATS_PHASE(storage, STORAGE_PHASE_PREPARE);
+	}
+	return status;
+}
+
+static STORAGE_STATUS storage_driver_read_done(STORAGE* storage)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	if (storage->driver_cb->on_storage_read_done)
+	{
+		STORAGE_STATS_START(storage);
+		status = storage->driver_cb->on_storage_read_done(storage->driver_param);
+		STORAGE_STATS_PHASE(storage, STORAGE_PHASE_DONE);
+	}
+	return status;
+}
+
+static STORAGE_STATUS storage_driver_prepare_write(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	if (storage->driver_cb->on_storage_prepare_write)
+	{
+		STORAGE_STATS_START(storage);
+		status = storage->driver_cb->on_storage_prepare_write(storage->driver_param, addr, count);
+		STORAGE_STATS_PHASE(storage, STORAGE_PHASE_PREPARE);
+	}
+	return status;
+}
+
+static STORAGE_STATUS storage_driver_write_done(STORAGE* storage)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	if (storage->driver_cb->on_storage_write_done)
+	{
+		STORAGE_STATS_START(storage);
+		status = storage->driver_cb->on_storage_write_done(storage->driver_param);
+		STORAGE_STATS_PHASE(storage, STORAGE_PHASE_DONE);
+	}
+	return status;
+}
+
+void storage_update_state(STORAGE* storage)
+{
+	STORAGE_STATE state = STORAGE_STATE_IDLE;
+	if (storage->reading && storage->writing)
+		state = STORAGE_STATE_READ_WRITE;
+	else if (storage->writing)
+		state = STORAGE_STATE_WRITE;
+	else if (storage->reading)
+		state = STORAGE_STATE_READ;
+
+	STORAGE_HOST_CB* cur;
+	DLIST_ENUM de;
+	dlist_enum_start((DLIST**)&storage->host_cb, &de);
+	while (dlist_enum(&de, (DLIST**)&cur))
+	{
+		if (cur->state_changed)
+			cur->state_changed(cur->param, state);
+	}
+}
+
+#if (STORAGE_CACHE_SECTORS)
+#define STORAGE_CACHE_HASH(addr)							((addr) % STORAGE_CACHE_SECTORS)
+
+static void storage_cache_create(STORAGE* storage)
+{
+	unsigned int i;
+	STORAGE_CACHE* cache = (STORAGE_CACHE*)sys_alloc(sizeof(STORAGE_CACHE));
+	if (cache == NULL)
+	{
+		error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, "STORAGE");
+		return;
+	}
+	//data is allocated in current thread's memory pool
+	cache->entries = (STORAGE_CACHE_ENTRY*)malloc(STORAGE_CACHE_SECTORS * sizeof(STORAGE_CACHE_ENTRY));
+	cache->hash = (STORAGE_CACHE_ENTRY**)malloc(STORAGE_CACHE_SECTORS * sizeof(STORAGE_CACHE_ENTRY*));
+	cache->data = (char*)malloc(STORAGE_CACHE_SECTORS * storage->device_descriptor->sector_size);
+	if (cache->entries == NULL || cache->hash == NULL || cache->data == NULL)
+	{
+		if (cache->entries)
+			free(cache->entries);
+		if (cache->hash)
+			free(cache->hash);
+		if (cache->data)
+			free(cache->data);
+		sys_free(cache);
+		error(ERROR_MEM_OUT_OF_HEAP, "STORAGE");
+		return;
+	}
+	cache->lru = NULL;
+	cache->dirty_count = 0;
+	cache->hits = cache->misses = 0;
+	for (i = 0; i < STORAGE_CACHE_SECTORS; ++i)
+	{
+		cache->hash[i] = NULL;
+		cache->entries[i].valid = cache->entries[i].dirty = false;
+		cache->entries[i].data = cache->data + i * storage->device_descriptor->sector_size;
+		dlist_add_tail((DLIST**)&cache->lru, (DLIST*)&cache->entries[i]);
+	}
+	storage->cache = cache;
+}
+
+static void storage_cache_destroy(STORAGE* storage)
+{
+	if (storage->cache)
+	{
+		free(storage->cache->entries);
+		free(storage->cache->hash);
+		free(storage->cache->data);
+		sys_free(storage->cache);
+	}
+}
+
+static STORAGE_CACHE_ENTRY* storage_cache_find(STORAGE_CACHE* cache, unsigned long addr)
+{
+	STORAGE_CACHE_ENTRY* entry;
+	for (entry = cache->hash[STORAGE_CACHE_HASH(addr)]; entry != NULL; entry = entry->next_hash)
+		if (entry->addr == addr)
+			return entry;
+	return NULL;
+}
+
+static void storage_cache_unhash(STORAGE_CACHE* cache, STORAGE_CACHE_ENTRY* entry)
+{
+	STORAGE_CACHE_ENTRY** cur;
+	for (cur = &cache->hash[STORAGE_CACHE_HASH(entry->addr)]; *cur != entry; cur = &(*cur)->next_hash) {}
+	*cur = entry->next_hash;
+	entry->valid = false;
+	if (entry->dirty)
+	{
+		entry->dirty = false;
+		--cache->dirty_count;
+	}
+	//reuse first
+	dlist_remove((DLIST**)&cache->lru, (DLIST*)entry);
+	dlist_add_head((DLIST**)&cache->lru, (DLIST*)entry);
+}
+
+static STORAGE_STATUS storage_driver_write_sector(STORAGE* storage, unsigned long addr, char* buf)
+{
+	storage->write_status = storage_driver_prepare_write(storage, addr, 1);
+	if (storage->write_status == STORAGE_STATUS_OK)
+	{
+		event_clear(storage->tx_event);
+		STORAGE_STATS_START(storage);
+		storage->write_status = storage->driver_cb->on_storage_write_blocks(storage->driver_param, addr, buf, 1);
+		if (storage->write_status == STORAGE_STATUS_OK)
+			event_wait_ms(storage->tx_event, INFINITE);
+		STORAGE_STATS_PHASE(storage, STORAGE_PHASE_BLOCK);
+		if (storage->write_status == STORAGE_STATUS_OK)
+			storage->write_status = storage_driver_write_done(storage);
+	}
+	return storage->write_status;
+}
+
+static STORAGE_STATUS storage_cache_write_entry(STORAGE* storage, STORAGE_CACHE_ENTRY* entry)
+{
+	STORAGE_STATUS status = storage_driver_write_sector(storage, entry->addr, entry->data);
+	if (status == STORAGE_STATUS_OK)
+	{
+		entry->dirty = false;
+		--storage->cache->dirty_count;
+	}
+	return status;
+}
+
+//dirty entry is written back, if evicted. Clean entry is never evicting dirty one, to keep driver in read state.
+static bool storage_cache_put(STORAGE* storage, unsigned long addr, char* data, bool dirty)
+{
+	STORAGE_CACHE* cache = storage->cache;
+	DLIST_ENUM de;
+	STORAGE_CACHE_ENTRY* entry = storage_cache_find(cache, addr);
+	if (entry == NULL)
+	{
+		if (dirty)
+		{
+			entry = cache->lru;
+			if (entry->dirty && storage_cache_write_entry(storage, entry) != STORAGE_STATUS_OK)
+				return false;
+		}
+		else
+		{
+			dlist_enum_start((DLIST**)&cache->lru, &de);
+			while (dlist_enum(&de, (DLIST**)&entry))
+				if (!entry->dirty)
+					break;
+			if (entry == NULL || entry->dirty)
+				return false;
+		}
+		if (entry->valid)
+			storage_cache_unhash(cache, entry);
+		entry->addr = addr;
+		entry->valid = true;
+		entry->next_hash = cache->hash[STORAGE_CACHE_HASH(addr)];
+		cache->hash[STORAGE_CACHE_HASH(addr)] = entry;
+	}
+	//cached data is newer, than readed
+	if (dirty || !entry->dirty)
+		memcpy(entry->data, data, storage->device_descriptor->sector_size);
+	if (dirty && !entry->dirty)
+	{
+		entry->dirty = true;
+		++cache->dirty_count;
+	}
+	dlist_remove((DLIST**)&cache->lru, (DLIST*)entry);
+	dlist_add_tail((DLIST**)&cache->lru, (DLIST*)entry);
+	return true;
+}
+
+static bool storage_cache_contains(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	unsigned long i;
+	for (i = 0; i < count; ++i)
+		if (storage_cache_find(storage->cache, addr + i) == NULL)
+			return false;
+	return true;
+}
+
+static void storage_cache_get(STORAGE* storage, unsigned long addr, char* buf, unsigned long count)
+{
+	STORAGE_CACHE* cache = storage->cache;
+	STORAGE_CACHE_ENTRY* entry;
+	unsigned long i;
+	for (i = 0; i < count; ++i)
+	{
+		entry = storage_cache_find(cache, addr + i);
+		memcpy(buf + i * storage->device_descriptor->sector_size, entry->data, storage->device_descriptor->sector_size);
+		dlist_remove((DLIST**)&cache->lru, (DLIST*)entry);
+		dlist_add_tail((DLIST**)&cache->lru, (DLIST*)entry);
+	}
+}
+
+//dirty sectors are not on media yet
+static void storage_cache_overlay(STORAGE* storage, unsigned long addr, char* buf, unsigned long count)
+{
+	STORAGE_CACHE_ENTRY* entry;
+	unsigned long i;
+	if (storage->cache->dirty_count == 0)
+		return;
+	for (i = 0; i < count; ++i)
+	{
+		entry = storage_cache_find(storage->cache, addr + i);
+		if (entry && entry->dirty)
+			memcpy(buf + i * storage->device_descriptor->sector_size, entry->data, storage->device_descriptor->sector_size);
+	}
+}
+
+static void storage_cache_invalidate_range(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_CACHE_ENTRY* entry;
+	unsigned long i;
+	//large ranges (discard) are faster to check by cache entries
+	if (count > STORAGE_CACHE_SECTORS)
+	{
+		for (i = 0; i < STORAGE_CACHE_SECTORS; ++i)
+		{
+			entry = &storage->cache->entries[i];
+			if (entry->valid && entry->addr >= addr && entry->addr < addr + count)
+				storage_cache_unhash(storage->cache, entry);
+		}
+		return;
+	}
+	for (i = 0; i < count; ++i)
+		if ((entry = storage_cache_find(storage->cache, addr + i)) != NULL)
+			storage_cache_unhash(storage->cache, entry);
+}
+
+static void storage_cache_invalidate(STORAGE* storage)
+{
+	unsigned int i;
+	if (storage->cache)
+	{
+		for (i = 0; i < STORAGE_CACHE_SECTORS; ++i)
+		{
+			storage->cache->hash[i] = NULL;
+			storage->cache->entries[i].valid = storage->cache->entries[i].dirty = false;
+		}
+		storage->cache->dirty_count = 0;
+	}
+}
+
+static STORAGE_STATUS storage_cache_flush(STORAGE* storage)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	unsigned int i;
+	if (storage->cache && storage->media_descriptor)
+		for (i = 0; i < STORAGE_CACHE_SECTORS && storage->cache->dirty_count && status == STORAGE_STATUS_OK; ++i)
+			if (storage->cache->entries[i].dirty)
+				status = storage_cache_write_entry(storage, &storage->cache->entries[i]);
+	return status;
+}
+
+static inline bool storage_is_cacheable(STORAGE* storage, unsigned long count)
+{
+	return storage->cache && count <= STORAGE_CACHE_MAX_REQUEST;
+}
+
+//cached requests are not going to driver, until eviction or flush
+static STORAGE_STATUS storage_cache_read(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	unsigned long sectors_cur;
+	char* buf;
+	storage->reading = true;
+	storage_update_state(storage);
+	while (count)
+	{
+		sectors_cur = storage->sectors_in_block;
+		if (sectors_cur > count)
+			sectors_cur = count;
+		buf = queue_allocate_buffer_ms(storage->queue, INFINITE);
+		storage_cache_get(storage, addr, buf, sectors_cur);
+		queue_push(storage->queue, buf);
+		storage->host_io_cb->on_storage_buffer_filled(storage->host_io_param, sectors_cur * storage->device_descriptor->sector_size);
+		count -= sectors_cur;
+		addr += sectors_cur;
+	}
+	storage->reading = false;
+	storage_update_state(storage);
+	return STORAGE_STATUS_OK;
+}
+
+static STORAGE_STATUS storage_cache_write(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	unsigned long sectors_cur, i;
+	char* buf;
+	storage->write_status = STORAGE_STATUS_OK;
+	storage->writing = true;
+	storage_update_state(storage);
+	while (count)
+	{
+		sectors_cur = storage->sectors_in_block;
+		if (sectors_cur > count)
+			sectors_cur = count;
+		storage->host_io_cb->on_storage_request_buffers(storage->host_io_param, sectors_cur * storage->device_descriptor->sector_size);
+		buf = queue_pull_ms(storage->queue, INFINITE);
+		for (i = 0; i < sectors_cur && storage->write_status == STORAGE_STATUS_OK; ++i)
+			//put can fail only on write back of evicted sector
+			if (!storage_cache_put(storage, addr + i, buf + i * storage->device_descriptor->sector_size, true))
+				storage->write_status = storage_driver_write_sector(storage, addr + i, buf + i * storage->device_descriptor->sector_size);
+		queue_release_buffer(storage->queue, buf);
+		count -= sectors_cur;
+		addr += sectors_cur;
+	}
+	storage->writing = false;
+	storage_update_state(storage);
+	return storage->write_status;
+}
+#endif //STORAGE_CACHE_SECTORS
+
+#if (STORAGE_READ_AHEAD)
+static void storage_read_ahead_wait(STORAGE* storage)
+{
+	STORAGE_STATUS status;
+	if (storage->ra_pending)
+	{
+		event_wait_ms(storage->rx_event, INFINITE);
+		storage->ra_pending = false;
+		status = storage->read_status;
+		if (status == STORAGE_STATUS_OK)
+			status = storage_driver_read_done(storage);
+		storage->read_status = STORAGE_STATUS_OK;
+		if (status != STORAGE_STATUS_OK)
+		{
+			queue_release_buffer(storage->queue, storage->ra_buf);
+			storage->ra_buf = NULL;
+		}
+	}
+}
+
+static void storage_read_ahead_cancel(STORAGE* storage)
+{
+	storage_read_ahead_wait(storage);
+	if (storage->ra_buf)
+	{
+		queue_release_buffer(storage->queue, storage->ra_buf);
+		storage->ra_buf = NULL;
+	}
+	storage->ra_window = 0;
+	storage->ra_next = STORAGE_NO_STREAM;
+}
+
+//media is gone, driver may never complete pending read-ahead
+static void storage_read_ahead_abort(STORAGE* storage)
+{
+	if (storage->ra_pending)
+	{
+		if (storage->driver_cb->on_cancel_io)
+			storage->driver_cb->on_cancel_io(storage->driver_param);
+		storage->ra_pending = false;
+		storage->read_status = STORAGE_STATUS_OK;
+	}
+	if (storage->ra_buf)
+	{
+		queue_release_buffer(storage->queue, storage->ra_buf);
+		storage->ra_buf = NULL;
+	}
+	storage->ra_window = 0;
+	storage->ra_next = STORAGE_NO_STREAM;
+}
+
+//return count of sectors, served from read-ahead buffer
+static unsigned long storage_read_ahead_take(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	unsigned long served = 0;
+	if (addr != storage->ra_next)
+	{
+		storage_read_ahead_cancel(storage);
+		return 0;
+	}
+	storage_read_ahead_wait(storage);
+	if (storage->ra_buf)
+	{
+		served = count < storage->ra_count ? count : storage->ra_count;
+#if (STORAGE_CACHE_SECTORS)
+		if (storage->cache)
+			storage_cache_overlay(storage, addr, storage->ra_buf, served);
+#endif //STORAGE_CACHE_SECTORS
+		queue_push(storage->queue, storage->ra_buf);
+		storage->host_io_cb->on_storage_buffer_filled(storage->host_io_param, served * storage->device_descriptor->sector_size);
+		storage->ra_buf = NULL;
+		//whole window is used, stream is going on - grow
+		if (served == storage->ra_count && storage->ra_window < storage->sectors_in_block)
+		{
+			storage->ra_window <<= 1;
+			if (storage->ra_window > storage->sectors_in_block)
+				storage->ra_window = storage->sectors_in_block;
+		}
+	}
+	return served;
+}
+
+//driver is reading next range, while host is draining current one
+static void storage_read_ahead_start(STORAGE* storage, unsigned long requested)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	unsigned long left;
+	//stream is broken by io error
+	if (storage->ra_next == STORAGE_NO_STREAM)
+		return;
+	//initial window is size of request
+	if (storage->ra_window == 0)
+		storage->ra_window = requested < storage->sectors_in_block ? requested : storage->sectors_in_block;
+	left = storage->media_descriptor->num_sectors - storage->ra_next;
+	storage->ra_count = storage->ra_window < left ? storage->ra_window : left;
+	//never wait for buffer, host may need it
+	if (storage->ra_count == 0 || queue_is_full(storage->queue))
+		return;
+	storage->ra_buf = queue_allocate_buffer_ms(storage->queue, INFINITE);
+	storage->ra_addr = storage->ra_next;
+	status = storage_driver_prepare_read(storage, storage->ra_addr, storage->ra_count);
+	if (status == STORAGE_STATUS_OK)
+	{
+		event_clear(storage->rx_event);
+		status = storage->driver_cb->on_storage_read_blocks(storage->driver_param, storage->ra_addr, storage->ra_buf, storage->ra_count);
+	}
+	if (status == STORAGE_STATUS_OK)
+		storage->ra_pending = true;
+	else
+	{
+		queue_release_buffer(storage->queue, storage->ra_buf);
+		storage->ra_buf = NULL;
+	}
+}
+#endif //STORAGE_READ_AHEAD
+
+static void storage_read_block_done(STORAGE* storage, unsigned long addr, char* buf, unsigned long sectors, bool cacheable)
+{
+#if (STORAGE_CACHE_SECTORS)
+	unsigned long i;
+	if (storage->cache)
+	{
+		storage_cache_overlay(storage, addr, buf, sectors);
+		if (cacheable)
+			for (i = 0; i < sectors; ++i)
+				storage_cache_put(storage, addr + i, buf + i * storage->device_descriptor->sector_size, false);
+	}
+#endif //STORAGE_CACHE_SECTORS
+	queue_push(storage->queue, buf);
+	storage->host_io_cb->on_storage_buffer_filled(storage->host_io_param, sectors * storage->device_descriptor->sector_size);
+}
+
+static STORAGE_IO* storage_io_add(STORAGE* storage, char* buf, unsigned long addr, unsigned long count)
+{
+	STORAGE_IO* io = &storage->io[(storage->io_head + storage->io_count) % storage->io_depth];
+	io->buf = buf;
+	io->addr = addr;
+	io->count = count;
+	io->status = STORAGE_STATUS_OPERATION_IN_PROGRESS;
+	++storage->io_count;
+#if (STORAGE_IO_STATS)
+	get_uptime(&io->start);
+	if (storage->io_count > storage->stats.in_flight_max)
+		storage->stats.in_flight_max = storage->io_count;
+#endif //STORAGE_IO_STATS
+	return io;
+}
+
+static void storage_io_remove(STORAGE* storage)
+{
+	storage->io_head = (storage->io_head + 1) % storage->io_depth;
+	--storage->io_count;
+}
+
+//completion order is not required
+static STORAGE_IO* storage_io_wait(STORAGE* storage, unsigned int idx)
+{
+	STORAGE_IO* io = &storage->io[(storage->io_head + idx) % storage->io_depth];
+	while (io->status == STORAGE_STATUS_OPERATION_IN_PROGRESS)
+		sempahore_wait_ms(storage->io_sem, INFINITE);
+	return io;
+}
+
+static void storage_io_drain(STORAGE* storage)
+{
+	unsigned int i;
+	for (i = 0; i < storage->io_count; ++i)
+		storage_io_wait(storage, i);
+}
+
+static bool storage_io_complete(STORAGE* storage, char* buf, STORAGE_STATUS status)
+{
+	unsigned int i;
+	STORAGE_IO* io;
+	if (storage->io)
+		for (i = 0; i < storage->io_count; ++i)
+		{
+			io = &storage->io[(storage->io_head + i) % storage->io_depth];
+			if (io->buf == buf && io->status == STORAGE_STATUS_OPERATION_IN_PROGRESS)
+			{
+				io->status = status;
+				semaphore_signal(storage->io_sem);
+				return true;
+			}
+		}
+	return false;
+}
+
+//up to io_depth blocks are in driver, host is receiving completed ones at same time. Return sectors left
+static unsigned long storage_read_pipelined(STORAGE* storage, unsigned long addr, unsigned long count, bool cacheable)
+{
+	unsigned long submit_addr = addr;
+	unsigned long submit_left = count;
+	unsigned long sectors_cur;
+	STORAGE_STATUS status;
+	STORAGE_IO* io;
+	int retry = STORAGE_RETRY_COUNT;
+	while (storage->read_status == STORAGE_STATUS_OK && count)
+	{
+		//never wait for buffer, while completed block is not passed to host
+		while (submit_left && storage->io_count < storage->io_depth && (storage->io_count == 0 || !queue_is_full(storage->queue)))
+		{
+			sectors_cur = storage->sectors_in_block;
+			if (sectors_cur > submit_left)
+				sectors_cur = submit_left;
+			STORAGE_STATS_ADD(storage, host_waits, queue_is_full(storage->queue) ? 1 : 0);
+			io = storage_io_add(storage, queue_allocate_buffer_ms(storage->queue, INFINITE), submit_addr, sectors_cur);
+			status = storage->driver_cb->on_storage_read_blocks(storage->driver_param, submit_addr, io->buf, sectors_cur);
+			if (status != STORAGE_STATUS_OK)
+			{
+				io->status = status;
+				break;
+			}
+			submit_addr += sectors_cur;
+			submit_left -= sectors_cur;
+		}
+		io = storage_io_wait(storage, 0);
+#if (STORAGE_IO_STATS)
+		storage_stats_latency(storage, STORAGE_PHASE_BLOCK, &io->start);
+#endif //STORAGE_IO_STATS
+		storage->read_status = io->status;
+		if (storage->read_status == STORAGE_STATUS_OK)
+		{
+			storage_read_block_done(storage, io->addr, io->buf, io->count, cacheable);
+			retry = STORAGE_RETRY_COUNT;
+			count -= io->count;
+			addr += io->count;
+			storage_io_remove(storage);
+		}
+		else
+		{
+			//blocks after failed are readed again
+			storage_io_drain(storage);
+			for (; storage->io_count; storage_io_remove(storage))
+				queue_release_buffer(storage->queue, storage->io[storage->io_head].buf);
+			storage_cancel_io(storage);
+			while (retry-- && (storage->read_status == STORAGE_STATUS_TIMEOUT || storage->read_status == STORAGE_STATUS_CRC_ERROR))
+			{
+				STORAGE_STATS_ADD(storage, retries, 1);
+				storage->read_status = storage_driver_prepare_read(storage, addr, count);
+			}
+			submit_addr = addr;
+			submit_left = count;
+		}
+	}
+	return count;
+}
+
+//host is filling next buffers, while driver is writing previous. Return sectors left
+static unsigned long storage_write_pipelined(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	unsigned long request_left = count;
+	unsigned long submit_addr = addr;
+	unsigned long submit_left = count;
+	unsigned long sectors_cur;
+	unsigned int requested = 0;
+	unsigned int i;
+	STORAGE_STATUS status;
+	STORAGE_IO* io;
+	int retry = STORAGE_RETRY_COUNT;
+	while (storage->write_status == STORAGE_STATUS_OK && count)
+	{
+		//host can't hold more buffers, than in queue
+		while (request_left && requested + storage->io_count < storage->io_depth)
+		{
+			sectors_cur = storage->sectors_in_block;
+			if (sectors_cur > request_left)
+				sectors_cur = request_left;
+			storage->host_io_cb->on_storage_request_buffers(storage->host_io_param, sectors_cur * storage->device_descriptor->sector_size);
+			request_left -= sectors_cur;
+			++requested;
+		}
+		//never wait for host, while driver completion is not processed
+		while (submit_left && requested && (storage->io_count == 0 || !queue_is_empty(storage->queue)))
+		{
+			sectors_cur = storage->sectors_in_block;
+			if (sectors_cur > submit_left)
+				sectors_cur = submit_left;
+			STORAGE_STATS_ADD(storage, host_waits, queue_is_empty(storage->queue) ? 1 : 0);
+			io = storage_io_add(storage, queue_pull_ms(storage->queue, INFINITE), submit_addr, sectors_cur);
+			--requested;
+			status = storage->driver_cb->on_storage_write_blocks(storage->driver_param, submit_addr, io->buf, sectors_cur);
+			if (status != STORAGE_STATUS_OK)
+			{
+				io->status = status;
+				break;
+			}
+			submit_addr += sectors_cur;
+			submit_left -= sectors_cur;
+		}
+		io = storage_io_wait(storage, 0);
+#if (STORAGE_IO_STATS)
+		storage_stats_latency(storage, STORAGE_PHASE_BLOCK, &io->start);
+#endif //STORAGE_IO_STATS
+		storage->write_status = io->status;
+		if (storage->write_status == STORAGE_STATUS_OK)
+		{
+#if (STORAGE_CACHE_SECTORS)
+			//cached copies are older
+			if (storage->cache)
+				storage_cache_invalidate_range(storage, io->addr, io->count);
+#endif //STORAGE_CACHE_SECTORS
+			queue_release_buffer(storage->queue, io->buf);
+			retry = STORAGE_RETRY_COUNT;
+			count -= io->count;
+			addr += io->count;
+			storage_io_remove(storage);
+		}
+		else
+		{
+			storage_io_drain(storage);
+			storage_cancel_io(storage);
+			while (retry-- && (storage->write_status == STORAGE_STATUS_TIMEOUT || storage->write_status == STORAGE_STATUS_CRC_ERROR))
+			{
+				STORAGE_STATS_ADD(storage, retries, 1);
+				storage->write_status = storage_driver_prepare_write(storage, addr, count);
+			}
+			//same buffers are written again
+			for (i = 0; i < storage->io_count && storage->write_status == STORAGE_STATUS_OK; ++i)
+			{
+				io = &storage->io[(storage->io_head + i) % storage->io_depth];
+				io->status = STORAGE_STATUS_OPERATION_IN_PROGRESS;
+				status = storage->driver_cb->on_storage_write_blocks(storage->driver_param, io->addr, io->buf, io->count);
+				if (status != STORAGE_STATUS_OK)
+					io->status = status;
+			}
+			if (storage->write_status != STORAGE_STATUS_OK)
+			{
+				storage_io_drain(storage);
+				for (; storage->io_count; storage_io_remove(storage))
+					queue_release_buffer(storage->queue, storage->io[storage->io_head].buf);
+			}
+		}
+	}
+	return count;
+}
+
 STORAGE* storage_create(const STORAGE_DEVICE_DESCRIPTOR *device_descriptor, STORAGE_DRIVER_CB *driver_cb,
 							void *driver_param)
 {
@@ -29,6 +759,19 @@ STORAGE* storage_create(const STORAGE_DEVICE_DESCRIPTOR *device_descriptor, STOR
 		storage->writing = false;
 		storage->queue = NULL;
 		storage->block_size = 0;
+		storage->cache = NULL;
+		storage->write_back = true;
+		storage->ra_buf = NULL;
+		storage->ra_pending = false;
+		storage->ra_window = 0;
+		storage->ra_next = STORAGE_NO_STREAM;
+		storage->io = NULL;
+		storage->io_depth = storage->io_head = storage->io_count = 0;
+		storage->io_sem = 0;
+		memset(&storage->stats, 0, sizeof(STORAGE_STATS));
+#if (STORAGE_CACHE_SECTORS)
+		storage_cache_create(storage);
+#endif //STORAGE_CACHE_SECTORS
 	}
 	else
 		error(ERROR_MEM_OUT_OF_SYSTEM_MEMORY, "STORAGE");
@@ -37,31 +780,22 @@ STORAGE* storage_create(const STORAGE_DEVICE_DESCRIPTOR *device_descriptor, STOR
 
 void storage_destroy(STORAGE* storage)
 {
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
+#if (STORAGE_CACHE_SECTORS)
+	storage_cache_destroy(storage);
+#endif //STORAGE_CACHE_SECTORS
+	if (storage->io)
+	{
+		free(storage->io);
+		semaphore_destroy(storage->io_sem);
+	}
 	event_destroy(storage->tx_event);
 	event_destroy(storage->rx_event);
 	sys_free(storage);
 }
 
-void storage_update_state(STORAGE* storage)
-{
-	STORAGE_STATE state = STORAGE_STATE_IDLE;
-	if (storage->reading && storage->writing)
-		state = STORAGE_STATE_READ_WRITE;
-	else if (storage->writing)
-		state = STORAGE_STATE_WRITE;
-	else if (storage->reading)
-		state = STORAGE_STATE_READ;
-
-	STORAGE_HOST_CB* cur;
-	DLIST_ENUM de;
-	dlist_enum_start((DLIST**)&storage->host_cb, &de);
-	while (dlist_enum(&de, (DLIST**)&cur))
-	{
-		if (cur->state_changed)
-			cur->state_changed(cur->param, state);
-	}
-}
-
 const STORAGE_DEVICE_DESCRIPTOR* storage_get_device_descriptor(STORAGE* storage)
 {
 	return storage->device_descriptor;
@@ -75,6 +809,9 @@ const STORAGE_MEDIA_DESCRIPTOR *storage_get_media_descriptor(STORAGE* storage)
 void storage_insert_media(STORAGE* storage, STORAGE_MEDIA_DESCRIPTOR* media)
 {
 	storage->media_descriptor = media;
+#if (STORAGE_CACHE_SECTORS)
+	storage_cache_invalidate(storage);
+#endif //STORAGE_CACHE_SECTORS
 	STORAGE_HOST_CB* cur;
 	DLIST_ENUM de;
 	dlist_enum_start((DLIST**)&storage->host_cb, &de);
@@ -89,11 +826,18 @@ void storage_eject_media(STORAGE* storage)
 {
 	if (storage->media_descriptor)
 	{
+#if (STORAGE_READ_AHEAD)
+		storage_read_ahead_abort(storage);
+#endif //STORAGE_READ_AHEAD
 		bool surprisal = storage->media_descriptor->flags & STORAGE_MEDIA_FLAG_REMOVAL_DISABLED ? true : false;
 		storage->reading = false;
 		storage->writing = false;
 		storage_update_state(storage);
 		storage->media_descriptor = NULL;
+#if (STORAGE_CACHE_SECTORS)
+		//media is already gone, dirty sectors are lost
+		storage_cache_invalidate(storage);
+#endif //STORAGE_CACHE_SECTORS
 		STORAGE_HOST_CB* cur;
 		DLIST_ENUM de;
 		dlist_enum_start((DLIST**)&storage->host_cb, &de);
@@ -117,6 +861,20 @@ void storage_blocks_writed(STORAGE* storage, STORAGE_STATUS status)
 	event_set(storage->tx_event);
 }
 
+void storage_buffer_readed(STORAGE* storage, char* buf, STORAGE_STATUS status)
+{
+	//not pipelined request: read-ahead, verify
+	if (!storage_io_complete(storage, buf, status))
+		storage_blocks_readed(storage, status);
+}
+
+void storage_buffer_writed(STORAGE* storage, char* buf, STORAGE_STATUS status)
+{
+	//not pipelined request: cache write back
+	if (!storage_io_complete(storage, buf, status))
+		storage_blocks_writed(storage, status);
+}
+
 void storage_register_handler(STORAGE* storage, STORAGE_HOST_CB* host_cb)
 {
 	dlist_add_tail((DLIST**)&storage->host_cb, (DLIST*)host_cb);
@@ -135,6 +893,20 @@ void storage_allocate_queue(STORAGE* storage, STORAGE_QUEUE_PARAMS* params)
 	ASSERT(storage->sectors_in_block * storage->device_descriptor->sector_size == storage->block_size);
 	storage->host_io_cb = params->host_io_cb;
 	storage->host_io_param = params->host_io_param;
+	if ((storage->device_descriptor->flags & STORAGE_DEVICE_FLAG_PIPELINED) && params->blocks_count > 1 && storage->io == NULL)
+	{
+		//data is allocated in current thread's memory pool
+		storage->io = (STORAGE_IO*)malloc(params->blocks_count * sizeof(STORAGE_IO));
+		if (storage->io == NULL)
+		{
+			error(ERROR_MEM_OUT_OF_HEAP, "STORAGE");
+			return;
+		}
+		storage->io_depth = params->blocks_count;
+		if (storage->device_descriptor->io_depth && storage->io_depth > storage->device_descriptor->io_depth)
+			storage->io_depth = storage->device_descriptor->io_depth;
+		storage->io_sem = semaphore_create();
+	}
 }
 
 void storage_disable_media_removal(STORAGE* storage)
@@ -153,6 +925,13 @@ void storage_stop(STORAGE* storage)
 {
 	if (storage->media_descriptor)
 	{
+#if (STORAGE_READ_AHEAD)
+		storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
+#if (STORAGE_CACHE_SECTORS)
+		storage_cache_flush(storage);
+		storage_cache_invalidate(storage);
+#endif //STORAGE_CACHE_SECTORS
 		storage->media_descriptor = NULL;
 		if (storage->driver_cb->on_stop)
 			storage->driver_cb->on_stop(storage->driver_param);
@@ -182,6 +961,9 @@ bool storage_is_media_present(STORAGE* storage)
 
 void storage_cancel_io(STORAGE* storage)
 {
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
 	if (storage->reading || storage->writing)
 	{
 		if (storage->driver_cb->on_cancel_io)
@@ -192,14 +974,102 @@ void storage_cancel_io(STORAGE* storage)
 	}
 }
 
-void storage_write_cache(STORAGE* storage)
+STORAGE_STATUS storage_write_cache(STORAGE* storage)
 {
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
+#if (STORAGE_CACHE_SECTORS)
+	//failed sectors are kept dirty, next flush will retry
+	status = storage_cache_flush(storage);
+#endif //STORAGE_CACHE_SECTORS
 	if (storage->driver_cb->on_write_cache)
 		storage->driver_cb->on_write_cache(storage->driver_param);
+	return status;
 }
 
-STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long count)
+bool storage_is_cache_present(STORAGE* storage)
+{
+	return storage->cache != NULL;
+}
+
+bool storage_is_write_cache_enabled(STORAGE* storage)
+{
+	return storage->cache != NULL && storage->write_back;
+}
+
+STORAGE_STATUS storage_set_write_cache(STORAGE* storage, bool enable)
+{
+	STORAGE_STATUS status = STORAGE_STATUS_OK;
+	if (storage->write_back && !enable)
+		status = storage_write_cache(storage);
+	storage->write_back = enable;
+	return status;
+}
+
+bool storage_is_cache_dirty(STORAGE* storage)
+{
+	return storage->cache != NULL && storage->cache->dirty_count && storage->media_descriptor != NULL;
+}
+
+void storage_get_cache_stat(STORAGE* storage, unsigned long* hits, unsigned long* misses)
+{
+	*hits = *misses = 0;
+	if (storage->cache)
+	{
+		*hits = storage->cache->hits;
+		*misses = storage->cache->misses;
+	}
+}
+
+void storage_get_stats(STORAGE* storage, STORAGE_STATS* stats)
+{
+	memcpy(stats, &storage->stats, sizeof(STORAGE_STATS));
+	stats->in_flight = storage->io_count;
+}
+
+void storage_reset_stats(STORAGE* storage)
+{
+	memset(&storage->stats, 0, sizeof(STORAGE_STATS));
+}
+
+static void storage_print_dir_stat(const char* name, STORAGE_DIR_STATS* dir)
 {
+	printf("%-8s%d ops, %d sectors, %d KB\n\r", name, dir->ops, dir->sectors, (unsigned long)(dir->bytes >> 10));
+}
+
+void storage_stat(STORAGE* storage)
+{
+	STORAGE_STATS stats;
+	unsigned int phase, i;
+	const char* const phase_names[STORAGE_PHASES_COUNT] = {"prepare", "block", "done"};
+	storage_get_stats(storage, &stats);
+	storage_print_dir_stat("read", &stats.read);
+	storage_print_dir_stat("write", &stats.write);
+	storage_print_dir_stat("verify", &stats.verify);
+	storage_print_dir_stat("discard", &stats.discard);
+	printf("retries: %d, host waits: %d, in flight: %d (max %d)\n\r", stats.retries, stats.host_waits, stats.in_flight, stats.in_flight_max);
+	printf("results by status:");
+	for (i = 0; i < STORAGE_STATUS_COUNT; ++i)
+		printf(" %d", stats.results[i]);
+	printf("\n\r");
+	//latency histograms, bucket N is 2^N us
+	for (phase = 0; phase < STORAGE_PHASES_COUNT; ++phase)
+	{
+		printf("%-8s", phase_names[phase]);
+		for (i = 0; i < STORAGE_HISTOGRAM_SIZE; ++i)
+			printf(" %d", stats.latency[phase][i]);
+		printf("\n\r");
+	}
+}
+
+static STORAGE_STATUS storage_read_request(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+#if (STORAGE_READ_AHEAD)
+	bool sequential;
+	unsigned long served, requested = count;
+#endif //STORAGE_READ_AHEAD
 	storage->read_status = STORAGE_STATUS_OK;
 	if (!storage->reading)
 	{
@@ -209,9 +1079,30 @@ STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long
 			{
 				if (addr < storage->media_descriptor->num_sectors && addr + count <= storage->media_descriptor->num_sectors)
 				{
-					if (storage->driver_cb->on_storage_prepare_read)
-						storage->read_status = storage->driver_cb->on_storage_prepare_read(storage->driver_param, addr, count);
-					if (storage->read_status == STORAGE_STATUS_OK)
+#if (STORAGE_READ_AHEAD)
+					sequential = addr == storage->ra_next;
+					served = storage_read_ahead_take(storage, addr, count);
+					storage->ra_next = addr + count;
+					addr += served;
+					count -= served;
+#endif //STORAGE_READ_AHEAD
+#if (STORAGE_CACHE_SECTORS)
+					if (count && storage_is_cacheable(storage, count))
+					{
+						//fully cached request is not going to driver at all
+						if (storage_cache_contains(storage, addr, count))
+						{
+							++storage->cache->hits;
+							storage->read_status = storage_cache_read(storage, addr, count);
+							count = 0;
+						}
+						else
+							++storage->cache->misses;
+					}
+#endif //STORAGE_CACHE_SECTORS
+					if (count)
+						storage->read_status = storage_driver_prepare_read(storage, addr, count);
+					if (count && storage->read_status == STORAGE_STATUS_OK)
 					{
 						storage->reading = true;
 						storage_update_state(storage);
@@ -219,24 +1110,32 @@ STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long
 						unsigned long sectors_left = count;
 						unsigned long sectors_cur;
 						char* buf;
+						bool cacheable = false;
+#if (STORAGE_CACHE_SECTORS)
+						cacheable = storage_is_cacheable(storage, count);
+#endif //STORAGE_CACHE_SECTORS
 						int retry = STORAGE_RETRY_COUNT;
+						if (storage->io)
+							sectors_left = storage_read_pipelined(storage, cur_addr, sectors_left, cacheable);
 						while (storage->read_status == STORAGE_STATUS_OK && sectors_left)
 						{
 							sectors_cur = storage->sectors_in_block;
 							if (sectors_cur > sectors_left)
 								sectors_cur = sectors_left;
 
+							STORAGE_STATS_ADD(storage, host_waits, queue_is_full(storage->queue) ? 1 : 0);
 							buf = queue_allocate_buffer_ms(storage->queue, INFINITE);
 
 							event_clear(storage->rx_event);
+							STORAGE_STATS_START(storage);
 							storage->read_status = storage->driver_cb->on_storage_read_blocks(storage->driver_param, cur_addr, buf, sectors_cur);
 							if (storage->read_status == STORAGE_STATUS_OK)
 								event_wait_ms(storage->rx_event, INFINITE);
+							STORAGE_STATS_PHASE(storage, STORAGE_PHASE_BLOCK);
 
 							if (storage->read_status == STORAGE_STATUS_OK)
 							{
-								queue_push(storage->queue, buf);
-								storage->host_io_cb->on_storage_buffer_filled(storage->host_io_param, sectors_cur * storage->device_descriptor->sector_size);
+								storage_read_block_done(storage, cur_addr, buf, sectors_cur, cacheable);
 								retry = STORAGE_RETRY_COUNT;
 								sectors_left -= sectors_cur;
 								cur_addr += sectors_cur;
@@ -247,17 +1146,20 @@ STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long
 								storage_cancel_io(storage);
 								while (retry-- && (storage->read_status == STORAGE_STATUS_TIMEOUT || storage->read_status == STORAGE_STATUS_CRC_ERROR))
 								{
-									storage->read_status = STORAGE_STATUS_OK;
-									if (storage->driver_cb->on_storage_prepare_read)
-										storage->read_status = storage->driver_cb->on_storage_prepare_read(storage->driver_param, cur_addr, sectors_left);
+									STORAGE_STATS_ADD(storage, retries, 1);
+									storage->read_status = storage_driver_prepare_read(storage, cur_addr, sectors_left);
 								}
 							}
 						}
 						storage->reading = false;
 						storage_update_state(storage);
-						if (storage->driver_cb->on_storage_read_done && sectors_left == 0)
-							storage->read_status = storage->driver_cb->on_storage_read_done(storage->driver_param);
+						if (sectors_left == 0)
+							storage->read_status = storage_driver_read_done(storage);
 					}
+#if (STORAGE_READ_AHEAD)
+					if (sequential && storage->read_status == STORAGE_STATUS_OK)
+						storage_read_ahead_start(storage, requested);
+#endif //STORAGE_READ_AHEAD
 				}
 				else
 					storage->read_status = STORAGE_STATUS_INVALID_ADDRESS;
@@ -277,10 +1179,22 @@ STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long
 	return storage->read_status;
 }
 
-STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long count)
+STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_STATUS status = storage_read_request(storage, addr, count);
+#if (STORAGE_IO_STATS)
+	storage_stats_op(storage, &storage->stats.read, count, status);
+#endif //STORAGE_IO_STATS
+	return status;
+}
+
+static STORAGE_STATUS storage_write_request(STORAGE* storage, unsigned long addr, unsigned long count)
 {
 	storage->write_status = STORAGE_STATUS_OK;
 	bool write_finished;
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
 	if (!storage->writing)
 	{
 		if (storage->media_descriptor)
@@ -289,8 +1203,11 @@ STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long
 			{
 				if (addr < storage->media_descriptor->num_sectors && addr + count <= storage->media_descriptor->num_sectors)
 				{
-					if (storage->driver_cb->on_storage_prepare_write)
-						storage->write_status = storage->driver_cb->on_storage_prepare_write(storage->driver_param, addr, count);
+#if (STORAGE_CACHE_SECTORS)
+					if (storage->write_back && storage_is_cacheable(storage, count))
+						return storage_cache_write(storage, addr, count);
+#endif //STORAGE_CACHE_SECTORS
+					storage->write_status = storage_driver_prepare_write(storage, addr, count);
 					if (storage->write_status == STORAGE_STATUS_OK)
 					{
 						storage->writing = true;
@@ -299,9 +1216,12 @@ STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long
 						unsigned long sectors_left = count;
 						unsigned long sectors_cur;
 						char* buf;
+						if (storage->io)
+							sectors_left = storage_write_pipelined(storage, cur_addr, sectors_left);
 						//double-buffering
-						storage->host_io_cb->on_storage_request_buffers(storage->host_io_param, sectors_left > storage->sectors_in_block ? storage->block_size :
-							sectors_left * storage->device_descriptor->sector_size);
+						else
+							storage->host_io_cb->on_storage_request_buffers(storage->host_io_param, sectors_left > storage->sectors_in_block ? storage->block_size :
+								sectors_left * storage->device_descriptor->sector_size);
 						int retry = STORAGE_RETRY_COUNT;
 						while (storage->write_status == STORAGE_STATUS_OK && sectors_left)
 						{
@@ -311,18 +1231,26 @@ STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long
 							sectors_cur = storage->sectors_in_block;
 							if (sectors_cur > sectors_left)
 								sectors_cur = sectors_left;
+							STORAGE_STATS_ADD(storage, host_waits, queue_is_empty(storage->queue) ? 1 : 0);
 							buf = queue_pull_ms(storage->queue, INFINITE);
 
 							write_finished = false;
 							while (retry && !write_finished)
 							{
 								event_clear(storage->tx_event);
+								STORAGE_STATS_START(storage);
 								storage->write_status = storage->driver_cb->on_storage_write_blocks(storage->driver_param, cur_addr, buf, sectors_cur);
 								if (storage->write_status == STORAGE_STATUS_OK)
 								{
 									event_wait_ms(storage->tx_event, INFINITE);
+									STORAGE_STATS_PHASE(storage, STORAGE_PHASE_BLOCK);
 									if (storage->write_status == STORAGE_STATUS_OK)
 									{
+#if (STORAGE_CACHE_SECTORS)
+										//cached copies are older
+										if (storage->cache)
+											storage_cache_invalidate_range(storage, cur_addr, sectors_cur);
+#endif //STORAGE_CACHE_SECTORS
 										queue_release_buffer(storage->queue, buf);
 										sectors_left -= sectors_cur;
 										cur_addr += sectors_cur;
@@ -334,17 +1262,16 @@ STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long
 									storage_cancel_io(storage);
 									while (retry-- && (storage->write_status == STORAGE_STATUS_TIMEOUT || storage->write_status == STORAGE_STATUS_CRC_ERROR))
 									{
-										storage->write_status = STORAGE_STATUS_OK;
-										if (storage->driver_cb->on_storage_prepare_write)
-											storage->write_status = storage->driver_cb->on_storage_prepare_write(storage->driver_param, cur_addr, sectors_left);
+										STORAGE_STATS_ADD(storage, retries, 1);
+										storage->write_status = storage_driver_prepare_write(storage, cur_addr, sectors_left);
 									}
 								}
 							}
 						}
 						storage->writing = false;
 						storage_update_state(storage);
-						if (storage->driver_cb->on_storage_write_done && sectors_left == 0)
-							storage->driver_cb->on_storage_write_done(storage->driver_param);
+						if (sectors_left == 0)
+							storage->write_status = storage_driver_write_done(storage);
 					}
 				}
 				else
@@ -365,10 +1292,22 @@ STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long
 	return storage->write_status;
 }
 
-STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned long count, bool byte_compare)
+STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_STATUS status = storage_write_request(storage, addr, count);
+#if (STORAGE_IO_STATS)
+	storage_stats_op(storage, &storage->stats.write, count, status);
+#endif //STORAGE_IO_STATS
+	return status;
+}
+
+static STORAGE_STATUS storage_verify_request(STORAGE* storage, unsigned long addr, unsigned long count, bool byte_compare)
 {
 	storage->read_status = STORAGE_STATUS_OK;
 	int retry = STORAGE_RETRY_COUNT;
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
 	if (!storage->reading)
 	{
 		if (storage->media_descriptor)
@@ -377,8 +1316,11 @@ STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned lon
 			{
 				if (addr < storage->media_descriptor->num_sectors && addr + count <= storage->media_descriptor->num_sectors)
 				{
-					if (storage->driver_cb->on_storage_prepare_read)
-						storage->read_status = storage->driver_cb->on_storage_prepare_read(storage->driver_param, addr, count);
+#if (STORAGE_CACHE_SECTORS)
+					//verify media, not cache
+					storage_cache_flush(storage);
+#endif //STORAGE_CACHE_SECTORS
+					storage->read_status = storage_driver_prepare_read(storage, addr, count);
 					if (storage->read_status == STORAGE_STATUS_OK)
 					{
 						storage->reading = true;
@@ -395,9 +1337,11 @@ STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned lon
 							if (sectors_cur > sectors_left)
 								sectors_cur = sectors_left;
 							event_clear(storage->rx_event);
+							STORAGE_STATS_START(storage);
 							storage->read_status = storage->driver_cb->on_storage_read_blocks(storage->driver_param, cur_addr, verify_buf, sectors_cur);
 							if (storage->read_status == STORAGE_STATUS_OK)
 								event_wait_ms(storage->rx_event, INFINITE);
+							STORAGE_STATS_PHASE(storage, STORAGE_PHASE_BLOCK);
 
 							if (storage->read_status == STORAGE_STATUS_OK)
 							{
@@ -417,9 +1361,8 @@ STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned lon
 								while (retry && (storage->read_status == STORAGE_STATUS_TIMEOUT || storage->read_status == STORAGE_STATUS_CRC_ERROR))
 								{
 									--retry;
-									storage->read_status = STORAGE_STATUS_OK;
-									if (storage->driver_cb->on_storage_prepare_read)
-										storage->read_status = storage->driver_cb->on_storage_prepare_read(storage->driver_param, cur_addr, sectors_left);
+									STORAGE_STATS_ADD(storage, retries, 1);
+									storage->read_status = storage_driver_prepare_read(storage, cur_addr, sectors_left);
 								}
 							}
 						}
@@ -430,8 +1373,7 @@ STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned lon
 							storage->reading = false;
 							storage_update_state(storage);
 						}
-						if (storage->driver_cb->on_storage_read_done)
-							storage->driver_cb->on_storage_read_done(storage->driver_param);
+						storage_driver_read_done(storage);
 
 						queue_release_buffer(storage->queue, verify_buf);
 					}
@@ -454,6 +1396,74 @@ STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned lon
 	return storage->read_status;
 }
 
+STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned long count, bool byte_compare)
+{
+	STORAGE_STATUS status = storage_verify_request(storage, addr, count, byte_compare);
+#if (STORAGE_IO_STATS)
+	storage_stats_op(storage, &storage->stats.verify, count, status);
+#endif //STORAGE_IO_STATS
+	return status;
+}
+
+bool storage_is_discard_supported(STORAGE* storage)
+{
+	return storage->driver_cb->on_storage_discard != NULL;
+}
+
+static STORAGE_STATUS storage_discard_request(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	storage->write_status = STORAGE_STATUS_OK;
+#if (STORAGE_READ_AHEAD)
+	storage_read_ahead_cancel(storage);
+#endif //STORAGE_READ_AHEAD
+	if (!storage->writing)
+	{
+		if (storage->media_descriptor)
+		{
+			if ((storage->media_descriptor->flags & STORAGE_MEDIA_FLAG_WRITE_PROTECTION) == 0)
+			{
+				if (addr < storage->media_descriptor->num_sectors && count <= storage->media_descriptor->num_sectors - addr)
+				{
+#if (STORAGE_CACHE_SECTORS)
+					//discarded data is not written back
+					if (storage->cache)
+						storage_cache_invalidate_range(storage, addr, count);
+#endif //STORAGE_CACHE_SECTORS
+					if (count && storage->driver_cb->on_storage_discard)
+					{
+						storage->writing = true;
+						storage_update_state(storage);
+						storage->write_status = storage->driver_cb->on_storage_discard(storage->driver_param, addr, count);
+						storage->writing = false;
+						storage_update_state(storage);
+					}
+				}
+				else
+					storage->write_status = STORAGE_STATUS_INVALID_ADDRESS;
+			}
+			else
+				storage->write_status = STORAGE_STATUS_DATA_PROTECTED;
+		}
+		else
+			storage->write_status = STORAGE_STATUS_NO_MEDIA;
+	}
+	else
+	{
+		storage_cancel_io(storage);
+		storage->write_status = STORAGE_STATUS_OPERATION_IN_PROGRESS;
+	}
+	return storage->write_status;
+}
+
+STORAGE_STATUS storage_discard(STORAGE* storage, unsigned long addr, unsigned long count)
+{
+	STORAGE_STATUS status = storage_discard_request(storage, addr, count);
+#if (STORAGE_IO_STATS)
+	storage_stats_op(storage, &storage->stats.discard, count, status);
+#endif //STORAGE_IO_STATS
+	return status;
+}
+
 char* storage_io_buf_allocate(STORAGE* storage)
 {
 	return queue_allocate_buffer_ms(storage->queue, INFINITE);
@@ -469,3 +1479,9 @@ void storage_io_buf_filled(STORAGE* storage, char* buf, unsigned long size)
 	queue_push(storage->queue, buf);
 	storage->host_io_cb->on_storage_buffer_filled(storage->host_io_param, size);
 }
+
+char* storage_io_buf_request(STORAGE* storage, unsigned long size)
+{
+	storage->host_io_cb->on_storage_request_buffers(storage->host_io_param, size);
+	return queue_pull_ms(storage->queue, INFINITE);
+}
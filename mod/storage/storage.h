@@ -7,9 +7,13 @@
 
 #include "types.h"
 #include "dlist.h"
+#include "time.h"
 
 #define STORAGE_DEVICE_FLAG_REMOVABLE			(1 << 0)
 #define STORAGE_DEVICE_FLAG_READ_ONLY			(1 << 1)
+//driver accepts many outstanding blocks, completing each by storage_buffer_readed/storage_buffer_writed.
+//Only ram_disk is pipelined yet, sd_card is served by double-buffering path
+#define STORAGE_DEVICE_FLAG_PIPELINED			(1 << 2)
 
 #define STORAGE_MEDIA_FLAG_WRITE_PROTECTION	(1 << 0)
 #define STORAGE_MEDIA_FLAG_READ_PROTECTION	(1 << 1)
@@ -30,6 +34,8 @@ typedef enum {
 	STORAGE_STATUS_MISCOMPARE
 }STORAGE_STATUS;
 
+#define STORAGE_STATUS_COUNT					(STORAGE_STATUS_MISCOMPARE + 1)
+
 typedef enum {
 	STORAGE_STATE_IDLE = 0,
 	STORAGE_STATE_READ,
@@ -46,12 +52,18 @@ typedef enum {
 typedef struct {
 	uint32_t flags;
 	uint16_t	sector_size;
+	//blocks, pipelined driver can hold at time. 0 - not limited
+	uint16_t io_depth;
 }STORAGE_DEVICE_DESCRIPTOR;
 
 typedef struct {
 	uint32_t num_sectors;
 	char serial_number[STORAGE_SERIAL_NUMBER_SIZE + 1];
 	uint32_t flags;
+	//sectors in one discard request, that media can handle in reasonable time. 0 - not limited
+	uint32_t discard_max_sectors;
+	//media can only discard aligned units of this sectors. 0 - unknown
+	uint32_t discard_granularity;
 }STORAGE_MEDIA_DESCRIPTOR;
 
 typedef struct {
@@ -78,8 +90,64 @@ typedef struct {
 	STORAGE_STATUS (*on_storage_write_done)(void* driver_param);
 	void (*on_write_cache)(void* driver_param);
 	void (*on_stop)(void* driver_param);
+	//optional. Sectors content is undefined after discard
+	STORAGE_STATUS (*on_storage_discard)(void* driver_param, unsigned long addr, unsigned long count);
 }STORAGE_DRIVER_CB, *P_STORAGE_DRIVER_CB;
 
+typedef struct _STORAGE_CACHE_ENTRY {
+	//LRU list, head is least recently used
+	DLIST lru;
+	struct _STORAGE_CACHE_ENTRY* next_hash;
+	unsigned long addr;
+	bool valid, dirty;
+	char* data;
+}STORAGE_CACHE_ENTRY;
+
+typedef struct {
+	STORAGE_CACHE_ENTRY* lru;
+	STORAGE_CACHE_ENTRY** hash;
+	STORAGE_CACHE_ENTRY* entries;
+	char* data;
+	unsigned int dirty_count;
+	unsigned long hits, misses;
+}STORAGE_CACHE;
+
+//log2 scale in us: bucket N is [2^N, 2^(N+1)), last is everything above
+#define STORAGE_HISTOGRAM_SIZE					20
+
+typedef enum {
+	STORAGE_PHASE_PREPARE = 0,
+	STORAGE_PHASE_BLOCK,
+	STORAGE_PHASE_DONE,
+	STORAGE_PHASES_COUNT
+}STORAGE_PHASE;
+
+typedef struct {
+	unsigned long ops, sectors;
+	unsigned long long bytes;
+}STORAGE_DIR_STATS;
+
+typedef struct {
+	STORAGE_DIR_STATS read, write, verify, discard;
+	unsigned long retries;
+	//completed requests by result
+	unsigned long results[STORAGE_STATUS_COUNT];
+	//blocks in driver at time
+	unsigned int in_flight, in_flight_max;
+	//storage was waiting for host: no free buffer on read, no data on write
+	unsigned long host_waits;
+	unsigned long latency[STORAGE_PHASES_COUNT][STORAGE_HISTOGRAM_SIZE];
+}STORAGE_STATS;
+
+//block, queued to pipelined driver
+typedef struct {
+	char* buf;
+	unsigned long addr, count;
+	TIME start;
+	//STORAGE_STATUS_OPERATION_IN_PROGRESS, until completed
+	volatile STORAGE_STATUS status;
+}STORAGE_IO;
+
 typedef struct {
 	const STORAGE_DEVICE_DESCRIPTOR* device_descriptor;
 	STORAGE_MEDIA_DESCRIPTOR* media_descriptor;
@@ -94,11 +162,26 @@ typedef struct {
 	HANDLE rx_event, tx_event;
 	HANDLE queue;
 	unsigned long block_size, sectors_in_block;
+	//sector cache, NULL if disabled
+	STORAGE_CACHE* cache;
+	//writes are completed in cache. Else cache is write-through
+	bool write_back;
+	//read-ahead of sequential stream into spare queue buffer
+	char* ra_buf;
+	unsigned long ra_addr, ra_count, ra_window, ra_next;
+	bool ra_pending;
+	//ring of blocks in driver, NULL if driver is not pipelined
+	STORAGE_IO* io;
+	unsigned int io_depth, io_head, io_count;
+	HANDLE io_sem;
+	STORAGE_STATS stats;
+	TIME stats_time;
 }STORAGE;
 
 typedef struct {
 	HANDLE queue;
 	unsigned long block_size;
+	unsigned int blocks_count;
 	STORAGE_HOST_IO_CB* host_io_cb;
 	void* host_io_param;
 }STORAGE_QUEUE_PARAMS;
@@ -114,6 +197,8 @@ void storage_insert_media(STORAGE* storage, STORAGE_MEDIA_DESCRIPTOR* media);
 void storage_eject_media(STORAGE* storage);
 void storage_blocks_readed(STORAGE* storage, STORAGE_STATUS status);
 void storage_blocks_writed(STORAGE* storage, STORAGE_STATUS status);
+void storage_buffer_readed(STORAGE* storage, char* buf, STORAGE_STATUS status);
+void storage_buffer_writed(STORAGE* storage, char* buf, STORAGE_STATUS status);
 
 //host api
 void storage_register_handler(STORAGE* storage, STORAGE_HOST_CB* host_cb);
@@ -128,13 +213,29 @@ bool storage_check_media(STORAGE* storage);
 //doesn't call driver to check media, just return last status
 bool storage_is_media_present(STORAGE* storage);
 void storage_cancel_io(STORAGE* storage);
-void storage_write_cache(STORAGE* storage);
+//flush write-back cache to media
+STORAGE_STATUS storage_write_cache(STORAGE* storage);
+bool storage_is_cache_present(STORAGE* storage);
+bool storage_is_write_cache_enabled(STORAGE* storage);
+//disabling flushes cache, further writes are going directly to media
+STORAGE_STATUS storage_set_write_cache(STORAGE* storage, bool enable);
+//cache has sectors, not written to media yet
+bool storage_is_cache_dirty(STORAGE* storage);
+void storage_get_cache_stat(STORAGE* storage, unsigned long* hits, unsigned long* misses);
+void storage_get_stats(STORAGE* storage, STORAGE_STATS* stats);
+void storage_reset_stats(STORAGE* storage);
+//print to debug console
+void storage_stat(STORAGE* storage);
 STORAGE_STATUS storage_read(STORAGE* storage, unsigned long addr, unsigned long count);
 STORAGE_STATUS storage_write(STORAGE* storage, unsigned long addr, unsigned long count);
 STORAGE_STATUS storage_verify(STORAGE* storage, unsigned long addr, unsigned long count, bool byte_compare);
+bool storage_is_discard_supported(STORAGE* storage);
+STORAGE_STATUS storage_discard(STORAGE* storage, unsigned long addr, unsigned long count);
 //io controlling api
 char* storage_io_buf_allocate(STORAGE* storage);
 void storage_io_buf_release(STORAGE* storage, char* buf);
 void storage_io_buf_filled(STORAGE* storage, char* buf, unsigned long size);
+//receive up to block_size bytes from host. Release after use
+char* storage_io_buf_request(STORAGE* storage, unsigned long size);
 
 #endif // STORAGE_H
@@ -30,73 +30,152 @@
 #include "thread.h"
 #include "dlist.h"
 #include "sys_timer.h"
+#include "sys_time.h"
 #include "kernel_config.h"
 #include "irq.h"
 #include "dbg.h"
 #include "error.h"
 
+#define SW_TIMER_STATE_IDLE					0
+//in sys_timer queue
+#define SW_TIMER_STATE_PENDING				1
+//expired, in dispatcher active list
+#define SW_TIMER_STATE_FIRED					2
+
 typedef struct {
 	TIMER timer;
 	SW_TIMER_HANDLER handler;
 	void* param;
-	bool active;
+	unsigned int state;
+	unsigned int dispatcher;
+#if (KERNEL_PROFILING)
+	unsigned int fired;
+	unsigned int latency_max_us;
+	unsigned long latency_total_us;
+#endif //KERNEL_PROFILING
 }SW_TIMER;
 
-static HANDLE _event;
-static SW_TIMER* _active_timers					= NULL;
+typedef struct {
+	HANDLE event;
+	SW_TIMER* active_timers;
+}SW_TIMER_DISPATCHER;
+
+static SW_TIMER_DISPATCHER _dispatchers[SW_TIMER_DISPATCHERS_COUNT];
+
+#if (KERNEL_PROFILING)
+static inline void sw_timer_update_stat(SW_TIMER* sw_timer, TIME* expired, TIME* uptime)
+{
+	TIME latency;
+	time_sub(expired, uptime, &latency);
+	unsigned int latency_us = time_to_us(&latency);
+	++sw_timer->fired;
+	sw_timer->latency_total_us += latency_us;
+	if (latency_us > sw_timer->latency_max_us)
+		sw_timer->latency_max_us = latency_us;
+}
+#endif //KERNEL_PROFILING
 
 void sw_timer_thread(void* param)
 {
+	SW_TIMER_DISPATCHER* dispatcher = (SW_TIMER_DISPATCHER*)param;
 	for (;;)
 	{
-		event_wait_ms(_event, INFINITE);
-		event_clear(_event);
+		event_wait_ms(dispatcher->event, INFINITE);
+		event_clear(dispatcher->event);
 
+		SW_TIMER* sw_timer;
 		SW_TIMER_HANDLER handler;
 		void* param = NULL;
+#if (KERNEL_PROFILING)
+		TIME expired, uptime;
+#endif //KERNEL_PROFILING
 		do {
 			CRITICAL_ENTER;
-			if (_active_timers)
+			sw_timer = dispatcher->active_timers;
+			if (sw_timer)
 			{
-				handler = _active_timers->handler;
-				param = _active_timers->param;
-				_active_timers->active = false;
-				dlist_remove_head((DLIST**)&_active_timers);
+				handler = sw_timer->handler;
+				param = sw_timer->param;
+				sw_timer->state = SW_TIMER_STATE_IDLE;
+#if (KERNEL_PROFILING)
+				expired.sec = sw_timer->timer.time.sec;
+				expired.usec = sw_timer->timer.time.usec;
+#endif //KERNEL_PROFILING
+				dlist_remove_head((DLIST**)&dispatcher->active_timers);
 			}
-			else
-				handler = NULL;
 			CRITICAL_LEAVE;
-			if (handler)
+			if (sw_timer)
+			{
+#if (KERNEL_PROFILING)
+				sw_timer_update_stat(sw_timer, &expired, get_uptime(&uptime));
+#endif //KERNEL_PROFILING
 				handler(param);
-		} while (handler);
+			}
+		} while (sw_timer);
 	}
 }
 
 void sw_timer_thread_wakeuper(void* param)
 {
 	SW_TIMER* sw_timer = (SW_TIMER*)param;
+	bool pending;
+	//called in sys_timer isr
 	CRITICAL_ENTER;
-	dlist_add_tail((DLIST**)&_active_timers, (DLIST*)sw_timer);
+	//timer is stopped after it was popped from sys_timer queue, but before we are here
+	pending = sw_timer->state == SW_TIMER_STATE_PENDING;
+	if (pending)
+	{
+		if (sw_timer->dispatcher == SW_TIMER_DISPATCHER_ISR)
+			sw_timer->state = SW_TIMER_STATE_IDLE;
+		else
+		{
+			sw_timer->state = SW_TIMER_STATE_FIRED;
+			dlist_add_tail((DLIST**)&_dispatchers[sw_timer->dispatcher].active_timers, (DLIST*)sw_timer);
+		}
+	}
 	CRITICAL_LEAVE;
-	event_set(_event);
+	if (!pending)
+		return;
+	if (sw_timer->dispatcher == SW_TIMER_DISPATCHER_ISR)
+	{
+#if (KERNEL_PROFILING)
+		TIME uptime;
+		sw_timer_update_stat(sw_timer, &sw_timer->timer.time, svc_get_uptime(&uptime));
+#endif //KERNEL_PROFILING
+		sw_timer->handler(sw_timer->param);
+	}
+	else
+		event_set(_dispatchers[sw_timer->dispatcher].event);
 }
 
-HANDLE sw_timer_create(SW_TIMER_HANDLER handler, void *param)
+HANDLE sw_timer_create_dispatched(SW_TIMER_HANDLER handler, void *param, unsigned int dispatcher)
 {
+	ASSERT(dispatcher < SW_TIMER_DISPATCHERS_COUNT || dispatcher == SW_TIMER_DISPATCHER_ISR);
 	SW_TIMER* sw_timer = (SW_TIMER*)sys_alloc(sizeof(SW_TIMER));
 	if (sw_timer)
 	{
-		sw_timer->active = false;
+		sw_timer->state = SW_TIMER_STATE_IDLE;
+		sw_timer->dispatcher = dispatcher;
 		sw_timer->handler = handler;
 		sw_timer->param = param;
 		sw_timer->timer.callback = sw_timer_thread_wakeuper;
 		sw_timer->timer.param = sw_timer;
+#if (KERNEL_PROFILING)
+		sw_timer->fired = 0;
+		sw_timer->latency_max_us = 0;
+		sw_timer->latency_total_us = 0;
+#endif //KERNEL_PROFILING
 	}
 	else
 		error_thread(ERROR_MEM_OUT_OF_SYSTEM_MEMORY);
 	return (HANDLE)sw_timer;
 }
 
+HANDLE sw_timer_create(SW_TIMER_HANDLER handler, void *param)
+{
+	return sw_timer_create_dispatched(handler, param, 0);
+}
+
 void sw_timer_destroy(HANDLE handle)
 {
 	sw_timer_stop(handle);
@@ -107,11 +186,11 @@ void sw_timer_destroy(HANDLE handle)
 void sw_timer_start(HANDLE handle, TIME* timeout)
 {
 	SW_TIMER* sw_timer = (SW_TIMER*)handle;
-	if (sw_timer->active)
+	if (sw_timer->state != SW_TIMER_STATE_IDLE)
 		sw_timer_stop(handle);
 	sw_timer->timer.time.sec = timeout->sec;
 	sw_timer->timer.time.usec = timeout->usec;
-	sw_timer->active = true;
+	sw_timer->state = SW_TIMER_STATE_PENDING;
 	sys_timer_create(&sw_timer->timer);
 }
 
@@ -133,24 +212,45 @@ void sw_timer_stop(HANDLE handle)
 {
 	SW_TIMER* sw_timer = (SW_TIMER*)handle;
 	bool need_destroy = false;
-	if (sw_timer->active)
+	CRITICAL_ENTER;
+	switch (sw_timer->state)
 	{
-		CRITICAL_ENTER;
-		sw_timer->active = false;
-		//worsest case, in active list
-		if (is_dlist_contains((DLIST**)&_active_timers, (DLIST*)sw_timer))
-			dlist_remove((DLIST**)&_active_timers, (DLIST*)sw_timer);
-		else
-			need_destroy = true;
-		CRITICAL_LEAVE;
-		if (need_destroy)
-			sys_timer_destroy(&sw_timer->timer);
+	case SW_TIMER_STATE_PENDING:
+		need_destroy = true;
+		break;
+	case SW_TIMER_STATE_FIRED:
+		//state is telling us, where timer is. No need to search
+		dlist_remove((DLIST**)&_dispatchers[sw_timer->dispatcher].active_timers, (DLIST*)sw_timer);
+		break;
 	}
+	sw_timer->state = SW_TIMER_STATE_IDLE;
+	CRITICAL_LEAVE;
+	//if timer fires right now, wakeuper will ignore it as not pending, and sys_timer will ignore destroy of fired timer
+	if (need_destroy)
+		sys_timer_destroy(&sw_timer->timer);
 }
 
+#if (KERNEL_PROFILING)
+void sw_timer_get_stat(HANDLE handle, SW_TIMER_STAT* stat)
+{
+	SW_TIMER* sw_timer = (SW_TIMER*)handle;
+	CRITICAL_ENTER;
+	stat->fired = sw_timer->fired;
+	stat->latency_max_us = sw_timer->latency_max_us;
+	stat->latency_avg_us = sw_timer->fired ? sw_timer->latency_total_us / sw_timer->fired : 0;
+	CRITICAL_LEAVE;
+}
+#endif //KERNEL_PROFILING
+
 void sw_timer_init()
 {
 	CHECK_CONTEXT(SUPERVISOR_CONTEXT | IRQ_CONTEXT | SYSTEM_CONTEXT);
-	_event = event_create();
-	thread_create_and_run("sw_timer", SW_TIMER_STACK_SIZE, SW_TIMER_PRIORITY, sw_timer_thread, NULL);
+	int i;
+	//dispatcher 0 is lowest priority, every next is SW_TIMER_DISPATCHER_PRIORITY_STEP higher
+	for (i = 0; i < SW_TIMER_DISPATCHERS_COUNT; ++i)
+	{
+		_dispatchers[i].event = event_create();
+		_dispatchers[i].active_timers = NULL;
+		thread_create_and_run("sw_timer", SW_TIMER_STACK_SIZE, SW_TIMER_PRIORITY - i * SW_TIMER_DISPATCHER_PRIORITY_STEP, sw_timer_thread, &_dispatchers[i]);
+	}
 }
@@ -29,15 +29,32 @@
 
 #include "types.h"
 #include "time.h"
+#include "kernel_config.h"
+
+//run handler directly in sys_timer isr. Only for short handlers, using isr-safe calls
+#define SW_TIMER_DISPATCHER_ISR				((unsigned int)-1)
 
 typedef void (*SW_TIMER_HANDLER)(void*);
 
+#if (KERNEL_PROFILING)
+typedef struct {
+	unsigned int fired;
+	unsigned int latency_max_us;
+	unsigned int latency_avg_us;
+}SW_TIMER_STAT;
+#endif //KERNEL_PROFILING
+
 HANDLE sw_timer_create(SW_TIMER_HANDLER handler, void* param);
+//dispatcher is 0..SW_TIMER_DISPATCHERS_COUNT - 1 or SW_TIMER_DISPATCHER_ISR
+HANDLE sw_timer_create_dispatched(SW_TIMER_HANDLER handler, void* param, unsigned int dispatcher);
 void sw_timer_destroy(HANDLE handle);
 void sw_timer_start(HANDLE handle, TIME* timeout);
 void sw_timer_start_ms(HANDLE handle, unsigned int timeout_ms);
 void sw_timer_start_us(HANDLE handle, unsigned int timeout_us);
 void sw_timer_stop(HANDLE handle);
+#if (KERNEL_PROFILING)
+void sw_timer_get_stat(HANDLE handle, SW_TIMER_STAT* stat);
+#endif //KERNEL_PROFILING
 
 void sw_timer_init();
 
@@ -112,6 +112,7 @@ USB_MSC* usb_msc_create(USBD *usbd, EP_CLASS ep_num, STORAGE* storage, SCSI_DESC
 		STORAGE_QUEUE_PARAMS params;
 		params.queue = msc->queue;
 		params.block_size = msc->block_size;
+		params.blocks_count = USB_MSC_BUFFERS_IN_QUEUE;
 		params.host_io_cb = (P_STORAGE_HOST_IO_CB)&_storage_cb;
 		params.host_io_param = msc;
 		storage_allocate_queue(storage, &params);
@@ -154,6 +154,14 @@ void usb_msc_thread(void* param)
 	USB_MSC* msc = (USB_MSC*)param;
 	for (;;)
 	{
+#if (STORAGE_CACHE_SECTORS) && (STORAGE_CACHE_FLUSH_MS)
+		//host is idle - write back dirty sectors. On fail they are kept dirty for SYNCHRONIZE CACHE
+		if (storage_is_cache_dirty(msc->scsi->storage) && !event_wait_ms(msc->event, STORAGE_CACHE_FLUSH_MS))
+		{
+			storage_write_cache(msc->scsi->storage);
+			continue;
+		}
+#endif //STORAGE_CACHE_SECTORS && STORAGE_CACHE_FLUSH_MS
 		event_wait_ms(msc->event, INFINITE);
 		msc->state = MSC_STATE_DATA;
 		//process received CBW